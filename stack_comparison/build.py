@@ -0,0 +1,189 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+#
+# Copyright © 2016 Martine Lenders <mail@martine-lenders.eu>
+#
+# Distributed under terms of the MIT license.
+
+"""
+Builds the experiments in parallel and reports build time and binary size
+per target.
+
+A target is skipped when neither its sources, its Makefiles, the make
+variables they read from the environment nor the RIOT revision changed since
+its last build. If ccache is installed the compilers are run through it with
+a cache shared by all targets, so RIOT modules compiled identically for
+several targets are only compiled once.
+"""
+
+import argparse
+import hashlib
+import multiprocessing
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+from run import APPS, STACKS, experiments
+
+STAMP_NAME = ".build_stamp"
+MAKE_VAR = re.compile(r"^\s*(\w+)\s*\?=", re.MULTILINE)
+COMPILERS = ["gcc", "g++", "arm-none-eabi-gcc", "arm-none-eabi-g++"]
+
+def which(name):
+    for path in os.environ.get("PATH", "").split(os.pathsep):
+        exe = os.path.join(path, name)
+        if os.path.isfile(exe) and os.access(exe, os.X_OK):
+            return exe
+    return None
+
+def riotbase():
+    return os.environ.get("RIOTBASE",
+                          os.path.join(os.getcwd(), "..", "..", "RIOT"))
+
+def riot_revision():
+    try:
+        return subprocess.check_output(["git", "-C", riotbase(), "rev-parse",
+                                        "HEAD"]).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+
+def setup_ccache(env, cache_dir):
+    """puts symlinks to ccache named like the compilers in front of PATH"""
+    ccache = which("ccache")
+    if ccache is None:
+        return False
+    bin_dir = os.path.abspath(os.path.join(cache_dir, "bin"))
+    if not os.path.isdir(bin_dir):
+        os.makedirs(bin_dir)
+    for compiler in COMPILERS:
+        link = os.path.join(bin_dir, compiler)
+        if which(compiler) and not os.path.lexists(link):
+            os.symlink(ccache, link)
+    env["PATH"] = os.pathsep.join([bin_dir, env.get("PATH", "")])
+    env["CCACHE_DIR"] = os.path.abspath(cache_dir)
+    # the targets live in different directories, but compile the same RIOT
+    # sources
+    env["CCACHE_BASEDIR"] = os.path.abspath(os.path.join(riotbase(), ".."))
+    env["CCACHE_NOHASHDIR"] = "1"
+    return True
+
+def elf_path(app, stack, board):
+    return os.path.join(app, stack, "bin", board, "%s_%s.elf" % (stack, app))
+
+def stamp(app, stack, env, riot_rev):
+    """hash of everything the build of a target depends on besides RIOT"""
+    path = os.path.join(app, stack)
+    digest = hashlib.sha1()
+    makefiles = [os.path.join(path, "Makefile"),
+                 os.path.join(app, "Makefile.common")]
+    variables = set()
+    for name in sorted(os.listdir(path)):
+        filename = os.path.join(path, name)
+        if os.path.isfile(filename):
+            digest.update(name.encode())
+            with open(filename, "rb") as f:
+                digest.update(f.read())
+    for makefile in makefiles:
+        if os.path.isfile(makefile):
+            with open(makefile) as f:
+                content = f.read()
+            digest.update(content.encode())
+            variables.update(MAKE_VAR.findall(content))
+    for var in sorted(variables):
+        digest.update(("%s=%s\n" % (var, env.get(var, ""))).encode())
+    digest.update(riot_rev.encode())
+    return digest.hexdigest()
+
+def elf_size(elf, board):
+    size_cmd = "size" if board == "native" else "arm-none-eabi-size"
+    try:
+        out = subprocess.check_output([size_cmd, elf]).decode().splitlines()
+        return tuple(int(v) for v in out[1].split()[:3])
+    except (OSError, subprocess.CalledProcessError, IndexError, ValueError):
+        return None
+
+def build_target(args):
+    app, stack, env, riot_rev, force = args
+    board = env.get("BOARD", "iotlab-m3")
+    elf = elf_path(app, stack, board)
+    stamp_file = os.path.join(os.path.dirname(elf), STAMP_NAME)
+    digest = stamp(app, stack, env, riot_rev)
+    start = time.time()
+    if not force and os.path.isfile(elf) and os.path.isfile(stamp_file):
+        with open(stamp_file) as f:
+            if f.read().strip() == digest:
+                return app, stack, "skipped", 0.0, elf_size(elf, board)
+    # make does not notice changed CFLAGS, so changed targets are rebuilt
+    # from scratch (cheap with ccache). Not with `make clean`, which would
+    # also clean the package sources other targets of the stack are built
+    # from in parallel.
+    if os.path.isdir(os.path.dirname(elf)):
+        shutil.rmtree(os.path.dirname(elf))
+    with open(os.devnull, "w") as devnull:
+        res = subprocess.call(["make", "-C", os.path.join(app, stack), "all"],
+                              env=env, stdout=devnull,
+                              stderr=subprocess.STDOUT)
+    duration = time.time() - start
+    if res != 0:
+        return app, stack, "failed", duration, None
+    with open(stamp_file, "w") as f:
+        f.write("%s\n" % digest)
+    return app, stack, "built", duration, elf_size(elf, board)
+
+def build_all(exps, env, jobs=None, force=False, ccache=True,
+              cache_dir=".ccache"):
+    env = dict(env)
+    if ccache:
+        setup_ccache(env, cache_dir)
+    riot_rev = riot_revision()
+    pool = multiprocessing.Pool(jobs or multiprocessing.cpu_count())
+    # the first target of a stack fetches and patches the shared package
+    # sources, so it is built before the other targets of the stack
+    firsts = []
+    for app, stack in exps:
+        if stack not in [s for _, s in firsts]:
+            firsts.append((app, stack))
+    rest = [e for e in exps if e not in firsts]
+    results = []
+    for batch in (firsts, rest):
+        results.extend(pool.map(build_target,
+                                [(app, stack, env, riot_rev, force)
+                                 for app, stack in batch]))
+    pool.close()
+    pool.join()
+    return results
+
+def report(results):
+    print("%-22s %-8s %8s %8s %8s %8s" % ("target", "result", "time_s",
+                                          "text", "data", "bss"))
+    for app, stack, res, duration, size in results:
+        text, data, bss = size if size else ("-", "-", "-")
+        print("%-22s %-8s %8.1f %8s %8s %8s" % ("%s_%s" % (stack, app), res,
+                                                duration, text, data, bss))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("-a", "--apps", nargs="+", default=APPS, choices=APPS)
+    parser.add_argument("-s", "--stacks", nargs="+", default=STACKS,
+                        choices=STACKS)
+    parser.add_argument("-j", "--jobs", type=int, default=None)
+    parser.add_argument("-B", "--always-make", action="store_true",
+                        help="build targets even if they are unchanged")
+    parser.add_argument("--no-ccache", action="store_true")
+    args = parser.parse_args()
+
+    start = time.time()
+    results = build_all(list(experiments(args.apps, args.stacks)),
+                        os.environ, args.jobs, args.always_make,
+                        not args.no_ccache)
+    report(results)
+    print("Building took %.2f minutes" % ((time.time() - start) / 60))
+    return 1 if any(r[2] == "failed" for r in results) else 0
+
+if __name__ == "__main__":
+    os.chdir(os.path.dirname(os.path.abspath(sys.argv[0])))
+    sys.exit(main())
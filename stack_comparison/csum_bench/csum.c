@@ -0,0 +1 @@
+../time_tx/gnrc/csum.c
\ No newline at end of file
@@ -0,0 +1 @@
+../time_tx/gnrc/csum.h
\ No newline at end of file
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Compares implementations of the Internet checksum
+ *
+ * Every implementation sums up @ref EXP_RUNS times a buffer of every payload
+ * size of the experiments. Per payload size and implementation one row with
+ * the mean time per call is printed. Results are checked against RIOT's
+ * `inet_csum()`.
+ *
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "net/inet_csum.h"
+#include "xtimer.h"
+
+#include "csum.h"
+#include "exp.h"
+#include "timing.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define CSUM_BENCH_X86
+#endif
+
+typedef uint16_t (*csum_func_t)(uint16_t sum, const uint8_t *buf, size_t len);
+
+typedef struct {
+    const char *name;
+    csum_func_t func;
+} csum_impl_t;
+
+/* odd offset, so unaligned access is part of the measurement */
+static uint8_t buffer[EXP_MAX_PAYLOAD + 1];
+static volatile uint16_t sink;
+
+static uint16_t _csum_riot(uint16_t sum, const uint8_t *buf, size_t len)
+{
+    return inet_csum(sum, buf, len);
+}
+
+static uint16_t _csum_bytes(uint16_t sum, const uint8_t *buf, size_t len)
+{
+    uint32_t acc = sum;
+
+    for (size_t i = 0; i < len; i++) {
+        acc += (i & 1) ? buf[i] : (buf[i] << 8);
+    }
+    return csum_fold(acc);
+}
+
+static uint16_t _csum_words32(uint16_t sum, const uint8_t *buf, size_t len)
+{
+    uint64_t acc = 0;
+    network_uint16_t res;
+
+    for (; len >= 4; buf += 4, len -= 4) {
+        uint32_t word;
+
+        memcpy(&word, buf, sizeof(word));
+        acc += word;
+    }
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    res.u16 = csum_fold((uint32_t)acc);
+    sum = csum_fold((uint32_t)sum + byteorder_ntohs(res));
+    return _csum_bytes(sum, buf, len);
+}
+
+#ifdef CSUM_BENCH_X86
+/* the 16-bit words are widened to 32-bit lanes, so the lanes can't overflow
+ * for less than 2^16 words per lane */
+__attribute__((target("sse2")))
+static uint16_t _csum_sse2(uint16_t sum, const uint8_t *buf, size_t len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    uint32_t lanes[4];
+    uint64_t total = 0;
+    network_uint16_t res;
+
+    for (; len >= 16; buf += 16, len -= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)buf);
+
+        acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+        acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+    }
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    for (unsigned i = 0; i < 4; i++) {
+        total += lanes[i];
+    }
+    total = (total & 0xffffffff) + (total >> 32);
+    res.u16 = csum_fold((uint32_t)total);
+    sum = csum_fold((uint32_t)sum + byteorder_ntohs(res));
+    return csum_inet(sum, buf, len);
+}
+
+__attribute__((target("avx2")))
+static uint16_t _csum_avx2(uint16_t sum, const uint8_t *buf, size_t len)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    uint32_t lanes[8];
+    uint64_t total = 0;
+    network_uint16_t res;
+
+    for (; len >= 32; buf += 32, len -= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)buf);
+
+        acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+        acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+    }
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    for (unsigned i = 0; i < 8; i++) {
+        total += lanes[i];
+    }
+    total = (total & 0xffffffff) + (total >> 32);
+    res.u16 = csum_fold((uint32_t)total);
+    sum = csum_fold((uint32_t)sum + byteorder_ntohs(res));
+    return csum_inet(sum, buf, len);
+}
+#endif
+
+static const csum_impl_t impls[] = {
+    { "riot", _csum_riot },
+    { "bytes", _csum_bytes },
+    { "words32", _csum_words32 },
+    { "unrolled", csum_inet },
+#ifdef CSUM_BENCH_X86
+    { "sse2", _csum_sse2 },
+    { "avx2", _csum_avx2 },
+#endif
+};
+
+#define IMPLS_NUMOF     (sizeof(impls) / sizeof(impls[0]))
+
+static bool _supported(const csum_impl_t *impl)
+{
+#ifdef CSUM_BENCH_X86
+    if (impl->func == _csum_sse2) {
+        return __builtin_cpu_supports("sse2");
+    }
+    if (impl->func == _csum_avx2) {
+        return __builtin_cpu_supports("avx2");
+    }
+#else
+    (void)impl;
+#endif
+    return true;
+}
+
+/* 0 and 0xffff are both zero in one's complement */
+static inline bool _equal(uint16_t a, uint16_t b)
+{
+    return (a == b) || ((a == 0 || a == 0xffff) && (b == 0 || b == 0xffff));
+}
+
+int main(void)
+{
+    const uint8_t *data = &buffer[1];
+
+    printf("%s started\n", APPLICATION_NAME);
+    xtimer_init();
+    timing_init();
+    for (unsigned i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = (i * 151) + 17;
+    }
+    puts("payload_len,impl,runs,mean_ns");
+    for (uint16_t payload_size = EXP_MIN_PAYLOAD;
+         payload_size <= EXP_MAX_PAYLOAD; payload_size += EXP_PAYLOAD_STEP) {
+        const uint16_t expected = inet_csum(0, data, payload_size);
+
+        for (unsigned i = 0; i < IMPLS_NUMOF; i++) {
+            uint32_t start, ticks;
+
+            if (!_supported(&impls[i])) {
+                continue;
+            }
+            if (!_equal(impls[i].func(0, data, payload_size), expected)) {
+                printf("# %s is wrong for payload length %u\n", impls[i].name,
+                       (unsigned)payload_size);
+                continue;
+            }
+            start = timing_now();
+            for (unsigned run = 0; run < EXP_RUNS; run++) {
+                sink = impls[i].func(run, data, payload_size);
+            }
+            ticks = timing_now() - start;
+            printf("%u,%s,%u,%" PRIu32 "\n", (unsigned)payload_size,
+                   impls[i].name, (unsigned)EXP_RUNS,
+                   (uint32_t)(timing_ticks_to_ns(ticks) / EXP_RUNS));
+        }
+    }
+    printf("%s stopped\n", APPLICATION_NAME);
+    return 0;
+}
+
+/** @} */
@@ -0,0 +1 @@
+../time_tx/gnrc/timing.h
\ No newline at end of file
@@ -0,0 +1,94 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+#
+# Copyright © 2016 Martine Lenders <mail@martine-lenders.eu>
+#
+# Distributed under terms of the MIT license.
+
+"""
+Converts the frames of experiments built with `OUTPUT=bin` back to the CSV
+rows the experiments print with `OUTPUT=csv`. All other lines are passed
+through unchanged, so the result can be used in place of a CSV log.
+
+Usage: decode.py [LOG [OUT]]
+"""
+
+import base64
+import binascii
+import re
+import struct
+import sys
+
+FRAME_PREFIX = "@"
+FRAME_VERSION = 1
+FRAME_HDR = struct.Struct("<BBBI")
+FRAME_RECORD = struct.Struct("<HHI")
+FRAME_CHKSUM = struct.Struct("<H")
+
+# serial_aggregator prefixes every line with "<timestamp>;<node>;"
+FRAME_RE = re.compile(r"^(?P<prefix>([^;]*;[^;]*;)?)%s(?P<frame>[A-Za-z0-9+/]+=*)\s*$"
+                      % re.escape(FRAME_PREFIX))
+
+class FrameError(Exception):
+    pass
+
+def fletcher16(data):
+    sum1 = 0
+    sum2 = 0
+    for byte in bytearray(data):
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return (sum2 << 8) | sum1
+
+def ticks_to_ns(ticks, ticks_hz):
+    # same result as timing_ticks_to_ns() in timing.h, which only splits off
+    # the seconds to not overflow 64 bit
+    return (ticks * 1000000000) // ticks_hz
+
+def decode_frame(frame):
+    try:
+        data = base64.b64decode(frame)
+    except (binascii.Error, TypeError) as e:
+        raise FrameError("invalid base64: %s" % e)
+    if len(data) < (FRAME_HDR.size + FRAME_CHKSUM.size):
+        raise FrameError("frame too short")
+    version, flags, count, ticks_hz = FRAME_HDR.unpack_from(data)
+    if version != FRAME_VERSION:
+        raise FrameError("unknown frame version %d" % version)
+    expected_len = FRAME_HDR.size + count * FRAME_RECORD.size + \
+                   FRAME_CHKSUM.size
+    if len(data) != expected_len:
+        raise FrameError("frame has %d bytes, expected %d" %
+                         (len(data), expected_len))
+    chksum, = FRAME_CHKSUM.unpack_from(data, expected_len - FRAME_CHKSUM.size)
+    if chksum != fletcher16(data[:-FRAME_CHKSUM.size]):
+        raise FrameError("checksum mismatch")
+    rows = []
+    for i in range(count):
+        payload_len, _, ticks = FRAME_RECORD.unpack_from(
+                data, FRAME_HDR.size + i * FRAME_RECORD.size
+            )
+        rows.append("%u,%u,%u" % (payload_len, ticks,
+                                  ticks_to_ns(ticks, ticks_hz)))
+    return rows
+
+def decode(infile, outfile):
+    errors = 0
+    for lineno, line in enumerate(infile, 1):
+        match = FRAME_RE.match(line)
+        if match is None:
+            outfile.write(line)
+            continue
+        try:
+            for row in decode_frame(match.group("frame")):
+                outfile.write("%s%s\n" % (match.group("prefix"), row))
+        except FrameError as e:
+            sys.stderr.write("line %d: %s\n" % (lineno, e))
+            errors += 1
+    return errors
+
+if __name__ == "__main__":
+    infile = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    outfile = open(sys.argv[2], "w") if len(sys.argv) > 2 else sys.stdout
+    sys.exit(1 if decode(infile, outfile) else 0)
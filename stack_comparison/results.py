@@ -0,0 +1,386 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+#
+# Copyright © 2016 Martine Lenders <mail@martine-lenders.eu>
+#
+# Distributed under terms of the MIT license.
+
+"""
+Stores the results of the experiments in an SQLite database by git revision
+and compares two revisions.
+
+    results.py import [-r REV] [-b BOARD] LOG...
+        imports logs of run.py (serial_aggregator) or run_native.py
+    results.py import-sizes [-r REV] [-b BOARD] [--size-cmd CMD]
+        imports ROM/RAM sizes of the built ELF files (see size_report.py for
+        the breakdown by module)
+    results.py compare REV_OLD REV_NEW
+        flags latency regressions significant in Welch's t-test, increased
+        stack usage and increased ROM/RAM sizes; exits with 1 if there are any
+
+The startup time of the stacks is imported as latency metric `startup` with
+payload length 0.
+"""
+
+import argparse
+import glob
+import math
+import os
+import re
+import sqlite3
+import subprocess
+import sys
+import time
+
+import decode
+
+DB_PATH = 'results.db'
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS runs (
+    id INTEGER PRIMARY KEY,
+    revision TEXT NOT NULL,
+    board TEXT NOT NULL,
+    source TEXT NOT NULL,
+    imported REAL NOT NULL
+);
+CREATE TABLE IF NOT EXISTS latency (
+    run INTEGER NOT NULL REFERENCES runs(id),
+    stack TEXT NOT NULL,
+    app TEXT NOT NULL,
+    metric TEXT NOT NULL,
+    payload_len INTEGER NOT NULL,
+    n INTEGER NOT NULL,
+    mean_ns REAL NOT NULL,
+    stddev_ns REAL NOT NULL
+);
+CREATE TABLE IF NOT EXISTS stack_usage (
+    run INTEGER NOT NULL REFERENCES runs(id),
+    stack TEXT NOT NULL,
+    app TEXT NOT NULL,
+    thread TEXT NOT NULL,
+    stack_size INTEGER NOT NULL,
+    stack_used INTEGER NOT NULL
+);
+CREATE TABLE IF NOT EXISTS sizes (
+    run INTEGER NOT NULL REFERENCES runs(id),
+    stack TEXT NOT NULL,
+    app TEXT NOT NULL,
+    text INTEGER NOT NULL,
+    data INTEGER NOT NULL,
+    bss INTEGER NOT NULL
+);
+CREATE TABLE IF NOT EXISTS module_sizes (
+    run INTEGER NOT NULL REFERENCES runs(id),
+    stack TEXT NOT NULL,
+    app TEXT NOT NULL,
+    module TEXT NOT NULL,
+    category TEXT NOT NULL,
+    text INTEGER NOT NULL,
+    data INTEGER NOT NULL,
+    bss INTEGER NOT NULL
+);
+CREATE INDEX IF NOT EXISTS runs_revision ON runs(revision);
+"""
+
+# serial_aggregator prefixes every line with "<timestamp>;<node>;"
+LINE_RE = re.compile(r"^(?:[^;]*;(?P<node>[^;]*);)?(?P<line>.*?)\s*$")
+STARTED_RE = re.compile(r"^(?P<stack>[a-z0-9]+)_(?P<app>\w+) started$")
+STACK_HEADER = ["thread", "stack_size", "stack_free"]
+
+def revision():
+    try:
+        return subprocess.check_output(['git', 'describe', '--always',
+                                        '--dirty']).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+def connect(path):
+    db = sqlite3.connect(path)
+    db.executescript(SCHEMA)
+    return db
+
+def add_run(db, rev, board, source):
+    cur = db.execute("INSERT INTO runs (revision, board, source, imported) "
+                     "VALUES (?, ?, ?, ?)", (rev, board, source, time.time()))
+    return cur.lastrowid
+
+class Welford(object):
+    def __init__(self):
+        self.n = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+
+    def add(self, value):
+        self.n += 1
+        delta = value - self.mean
+        self.mean += delta / self.n
+        self.m2 += delta * (value - self.mean)
+
+    def stddev(self):
+        return math.sqrt(self.m2 / (self.n - 1)) if self.n > 1 else 0.0
+
+class LogParser(object):
+    """
+    Keeps track of the app and the CSV header per node. Understands the raw
+    rows (`payload_len,<name>_ticks,<name>_ns` and the probes), the summaries
+    of `STATS=1` and the stack usage of `STACKTEST=1`. Other tables are
+    skipped.
+    """
+    def __init__(self):
+        self.nodes = {}
+        self.samples = {}
+        self.summaries = []
+        self.stack_usage = []
+
+    def feed(self, line):
+        match = LINE_RE.match(line)
+        node = self.nodes.setdefault(match.group("node"),
+                                     {"exp": None, "header": None})
+        line = match.group("line")
+        frame = decode.FRAME_RE.match(line)
+        if frame is not None:
+            try:
+                for row in decode.decode_frame(frame.group("frame")):
+                    self._row(node, row.split(","))
+            except decode.FrameError as e:
+                sys.stderr.write("skipping frame: %s\n" % e)
+            return
+        started = STARTED_RE.match(line)
+        if started is not None:
+            node["exp"] = (started.group("stack"), started.group("app"))
+            node["header"] = None
+        elif line.startswith("#") or ("," not in line):
+            return
+        elif line.split(",")[0] in ("payload_len", "thread"):
+            node["header"] = line.split(",")
+        else:
+            self._row(node, line.split(","))
+
+    def _row(self, node, fields):
+        header = node["header"]
+        if (node["exp"] is None) or (header is None) or \
+           (len(fields) != len(header)):
+            return
+        stack, app = node["exp"]
+        try:
+            if header == STACK_HEADER:
+                self.stack_usage.append((stack, app, fields[0], int(fields[1]),
+                                         int(fields[1]) - int(fields[2])))
+            elif (len(header) > 1) and (header[1] == "runs"):
+                self._summary(stack, app, header, fields)
+            else:
+                self._samples(stack, app, header, fields)
+        except ValueError:
+            pass
+
+    def _summary(self, stack, app, header, fields):
+        if int(fields[1]) == 0:
+            # output_step() prints a row even if nothing was recorded
+            return
+        means = [c for c in header if c.endswith("_mean_ns")]
+        for column in means:
+            metric = column[:-len("_mean_ns")]
+            stddev = "%s_stddev_ns" % metric
+            if stddev not in header:
+                continue
+            self.summaries.append((stack, app, metric, int(fields[0]),
+                                   int(fields[1]),
+                                   float(fields[header.index(column)]),
+                                   float(fields[header.index(stddev)])))
+
+    def _samples(self, stack, app, header, fields):
+        if any(not (c.endswith("_ns") or c.endswith("_ticks") or c == "id")
+               for c in header[1:]):
+            return
+        for i, column in enumerate(header[1:], 1):
+            if not column.endswith("_ns") or fields[i] == "":
+                continue
+            key = (stack, app, column[:-len("_ns")], int(fields[0]))
+            self.samples.setdefault(key, Welford()).add(float(fields[i]))
+
+    def latency(self):
+        rows = list(self.summaries)
+        for (stack, app, metric, payload_len), w in self.samples.items():
+            rows.append((stack, app, metric, payload_len, w.n, w.mean,
+                         w.stddev()))
+        return rows
+
+def import_logs(db, logs, rev, board):
+    for log in logs:
+        parser = LogParser()
+        with open(log) as f:
+            for line in f:
+                parser.feed(line)
+        run = add_run(db, rev, board, os.path.basename(log))
+        db.executemany("INSERT INTO latency VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+                       [(run,) + r for r in parser.latency()])
+        db.executemany("INSERT INTO stack_usage VALUES (?, ?, ?, ?, ?, ?)",
+                       [(run,) + r for r in parser.stack_usage])
+        print("Imported %d latency and %d stack usage rows from %s" %
+              (len(parser.latency()), len(parser.stack_usage), log))
+    db.commit()
+
+def import_sizes(db, rev, board, size_cmd):
+    rows = []
+    base = os.path.dirname(os.path.abspath(__file__))
+    for elf in sorted(glob.glob(os.path.join(base, "*", "*", "bin", board,
+                                             "*.elf"))):
+        app, stack = os.path.relpath(elf, base).split(os.sep)[:2]
+        out = subprocess.check_output([size_cmd, elf]).decode().splitlines()
+        text, data, bss = [int(v) for v in out[1].split()[:3]]
+        rows.append((stack, app, text, data, bss))
+    run = add_run(db, rev, board, "sizes")
+    db.executemany("INSERT INTO sizes VALUES (?, ?, ?, ?, ?, ?)",
+                   [(run,) + r for r in rows])
+    db.commit()
+    print("Imported sizes of %d binaries" % len(rows))
+
+def _betacf(a, b, x):
+    # continued fraction of the incomplete beta function (modified Lentz)
+    tiny = 1e-300
+    c = 1.0
+    d = 1.0 - (a + b) * x / (a + 1.0)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    res = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((a + m2 - 1) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        res *= d * c
+        aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        delta = d * c
+        res *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return res
+
+def _betai(a, b, x):
+    # regularized incomplete beta function I_x(a, b)
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) +
+                     a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * _betacf(a, b, x) / a
+    return 1.0 - front * _betacf(b, a, 1.0 - x) / b
+
+def welch(n1, mean1, sd1, n2, mean2, sd2):
+    """two-sided p-value of Welch's t-test"""
+    if (n1 < 2) or (n2 < 2):
+        return 1.0
+    v1 = sd1 ** 2 / n1
+    v2 = sd2 ** 2 / n2
+    if (v1 + v2) == 0:
+        return 0.0 if mean1 != mean2 else 1.0
+    t = (mean2 - mean1) / math.sqrt(v1 + v2)
+    df = (v1 + v2) ** 2 / ((v1 ** 2 / (n1 - 1) if v1 else 0) +
+                           (v2 ** 2 / (n2 - 1) if v2 else 0))
+    return _betai(df / 2.0, 0.5, df / (df + t ** 2))
+
+def _pool(rows):
+    """combines (n, mean, stddev) of several runs"""
+    n = sum(r[0] for r in rows)
+    mean = sum(r[0] * r[1] for r in rows) / n
+    m2 = sum((r[0] - 1) * r[2] ** 2 + r[0] * (r[1] - mean) ** 2 for r in rows)
+    return n, mean, math.sqrt(m2 / (n - 1)) if n > 1 else 0.0
+
+def _latency(db, rev):
+    res = {}
+    for row in db.execute("SELECT stack, app, metric, payload_len, n, mean_ns, "
+                          "stddev_ns FROM latency JOIN runs ON run = id "
+                          "WHERE revision = ?", (rev,)):
+        if row[4] > 0:  # empty summaries imported before they were skipped
+            res.setdefault(row[:4], []).append(row[4:])
+    return dict((k, _pool(v)) for k, v in res.items())
+
+def _latest(db, table, columns, rev):
+    # only the latest run of a revision counts for the deterministic values
+    res = {}
+    for row in db.execute("SELECT %s FROM %s JOIN runs ON run = id "
+                          "WHERE revision = ? ORDER BY imported" %
+                          (columns, table), (rev,)):
+        res[row[:-1]] = row[-1]
+    return res
+
+def compare(db, old, new, alpha, min_change):
+    regressions = 0
+    old_lat = _latency(db, old)
+    new_lat = _latency(db, new)
+    for key in sorted(set(old_lat) & set(new_lat)):
+        n1, mean1, sd1 = old_lat[key]
+        n2, mean2, sd2 = new_lat[key]
+        p = welch(n1, mean1, sd1, n2, mean2, sd2)
+        change = (mean2 - mean1) / mean1 if mean1 else 0.0
+        if (p < alpha) and (abs(change) > min_change):
+            regression = change > 0
+            regressions += regression
+            print("%s %s_%s %s payload_len=%d: %.0f ns -> %.0f ns (%+.1f%%, "
+                  "p=%.2g)" % ("REGRESSION " if regression else "improvement",
+                               key[0], key[1], key[2], key[3], mean1, mean2,
+                               change * 100, p))
+    for name, table, columns in (
+            ("stack usage", "stack_usage", "stack, app, thread, stack_used"),
+            ("ROM", "sizes", "stack, app, text + data"),
+            ("RAM", "sizes", "stack, app, data + bss")):
+        old_vals = _latest(db, table, columns, old)
+        new_vals = _latest(db, table, columns, new)
+        for key in sorted(set(old_vals) & set(new_vals)):
+            if new_vals[key] > old_vals[key]:
+                regressions += 1
+                print("REGRESSION  %s %s: %d -> %d bytes" %
+                      (" ".join(key), name, old_vals[key], new_vals[key]))
+    print("%d regressions" % regressions)
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawTextHelpFormatter
+        )
+    parser.add_argument('-d', '--db', default=DB_PATH)
+    sub = parser.add_subparsers(dest='command')
+    imp = sub.add_parser('import')
+    imp.add_argument('-r', '--revision', default=None)
+    imp.add_argument('-b', '--board', default='iotlab-m3')
+    imp.add_argument('logs', nargs='+')
+    sizes = sub.add_parser('import-sizes')
+    sizes.add_argument('-r', '--revision', default=None)
+    sizes.add_argument('-b', '--board', default='iotlab-m3')
+    sizes.add_argument('--size-cmd', default=None,
+                       help="default: size on native, arm-none-eabi-size else")
+    cmp = sub.add_parser('compare')
+    cmp.add_argument('-a', '--alpha', type=float, default=0.01,
+                     help="significance level of the t-test")
+    cmp.add_argument('-m', '--min-change', type=float, default=0.01,
+                     help="minimum relative change of the mean latency")
+    cmp.add_argument('old')
+    cmp.add_argument('new')
+    args = parser.parse_args()
+
+    db = connect(args.db)
+    if args.command == 'import':
+        import_logs(db, args.logs, args.revision or revision(), args.board)
+    elif args.command == 'import-sizes':
+        size_cmd = args.size_cmd or \
+                ('size' if args.board == 'native' else 'arm-none-eabi-size')
+        import_sizes(db, args.revision or revision(), args.board, size_cmd)
+    elif args.command == 'compare':
+        return 1 if compare(db, args.old, args.new, args.alpha,
+                            args.min_change) else 0
+    else:
+        parser.print_help()
+        return 2
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
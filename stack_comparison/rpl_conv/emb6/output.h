@@ -0,0 +1 @@
+../../time_tx/gnrc/output.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../time_tx/gnrc/probe.c
\ No newline at end of file
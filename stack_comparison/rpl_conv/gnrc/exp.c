@@ -0,0 +1,499 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Convergence time and control overhead of RPL
+ *
+ * The node boots as RPL router, but not as root, and joins the DODAG of a
+ * root simulated behind `netdevs[0]`. The root sends a DIO every
+ * @ref EXP_RPL_DIO_INTERVAL and on every DIS of the node and acknowledges the
+ * node's DAOs if requested. Reported are
+ *
+ * - the time from stack_init_rpl() until the DODAG root is routable and until
+ *   the first DAO,
+ * - the DIS, DIO, DAO and other frames and bytes sent by the node while
+ *   joining and during @ref EXP_RPL_STEADY after it joined and
+ * - the CPU time of the threads during @ref EXP_RPL_STEADY. Without data
+ *   traffic this is control processing only (requires schedstatistics).
+ *
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "irq.h"
+#include "msg.h"
+#include "sched.h"
+#include "sema.h"
+#include "net/ipv6.h"
+#include "net/protnum.h"
+#include "net/sixlowpan.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "csum.h"
+#include "netdev.h"
+#include "stack.h"
+
+#include "exp.h"
+
+#define FRAME_MAX_LEN           (127U)
+#define ICMPV6_HDR_LEN          (4U)
+#define ICMPV6_RPL              (155U)
+#define RPL_DIS                 (0x00)
+#define RPL_DIO                 (0x01)
+#define RPL_DAO                 (0x02)
+#define RPL_DAO_ACK             (0x03)
+#define RPL_DAO_K_FLAG          (0x80)
+#define RPL_DAO_LEN             (ICMPV6_HDR_LEN + 4U)
+#define RPL_INSTANCE_ID         (0U)
+#define RPL_MIN_HOP_RANK_INC    (256U)
+#define RPL_ROOT_RANK           (RPL_MIN_HOP_RANK_INC)
+#define RPL_MOP_STORING         (0x02)
+#define RPL_PREFIX_LEN          (64U)
+/* offsets in the root's DIO */
+#define DIO_DODAG_ID            (ICMPV6_HDR_LEN + 8U)
+#define DIO_PREFIX              (DIO_DODAG_ID + 16U + 16U + 16U)
+
+#define MSG_TYPE_DIO            (0x4c01)    /**< value != 0: answers a DIS */
+#define MSG_TYPE_DAO_ACK        (0x4c02)    /**< value: instance << 8 | seq */
+#define MSG_TYPE_POLL           (0x4c03)
+#define MSG_TYPE_END            (0x4c04)
+
+enum {
+    CTRL_DIS = 0,
+    CTRL_DIO,
+    CTRL_DAO,
+    CTRL_OTHER,     /**< neighbor discovery etc. */
+    CTRL_NUMOF,
+};
+
+typedef struct {
+    unsigned frames[CTRL_NUMOF];
+    unsigned bytes[CTRL_NUMOF];
+} ctrl_stats_t;
+
+static netdev2_t *const netdev = (netdev2_t *)&netdevs[0];
+static uint8_t root_l2[] = EXP_ADDR_L2;
+static uint8_t node_l2[] = NETDEV_ADDR_PREFIX;
+static const uint8_t bcast_l2[] = { 0xff, 0xff };
+static const ipv6_addr_t all_rpl_nodes = { {
+        0xff, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1a
+    } };
+static ipv6_addr_t root_ll = EXP_ADDR;
+static ipv6_addr_t node_ll;
+static ipv6_addr_t dodag_id = EXP_ADDR;
+static uint8_t dio[] = {
+    ICMPV6_RPL, RPL_DIO, 0x00, 0x00,
+    RPL_INSTANCE_ID, 0x00,                          /* version */
+    RPL_ROOT_RANK >> 8, RPL_ROOT_RANK & 0xff,
+    0x80 | (RPL_MOP_STORING << 3),                  /* grounded */
+    0x00, 0x00, 0x00,                               /* DTSN, flags */
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* DODAG ID */
+    /* DODAG configuration with the defaults of RFC 6550 and OF0 */
+    0x04, 14, 0x00, 20, 3, 10,
+    0x07, 0x00,                                     /* MaxRankIncrease */
+    RPL_MIN_HOP_RANK_INC >> 8, RPL_MIN_HOP_RANK_INC & 0xff,
+    0x00, 0x00,                                     /* OCP */
+    0x00, 0xff, 0xff, 0xff,                         /* lifetime */
+    /* prefix information for autoconfiguration */
+    0x08, 30, RPL_PREFIX_LEN, 0x40,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0x00, 0x00, 0x00, 0x00,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, /* prefix */
+};
+static uint8_t rx_frame[FRAME_MAX_LEN];
+static size_t rx_frame_len;
+static uint8_t rx_seq;
+static sema_t sync = SEMA_CREATE(0);
+static kernel_pid_t main_pid;
+static int frag_ctrl = CTRL_OTHER;
+static ctrl_stats_t ctrl_stats;
+static volatile bool dao_sent;
+static volatile uint32_t first_dao;
+#ifdef MODULE_SCHEDSTATISTICS
+static uint64_t cpu_start[KERNEL_PID_LAST + 1];
+static unsigned schedules_start[KERNEL_PID_LAST + 1];
+#endif
+
+static inline size_t min(const size_t a, const size_t b)
+{
+    return (a < b) ? a : b;
+}
+
+static void _netdev_isr(netdev2_t *dev)
+{
+    dev->event_callback(dev, NETDEV2_EVENT_RX_COMPLETE);
+}
+
+static int _netdev_recv(netdev2_t *dev, char *buf, int len, void *info)
+{
+    (void)dev;
+    if (buf == NULL) {
+        return rx_frame_len;
+    }
+    if ((size_t)len < rx_frame_len) {
+        sema_post(&sync);
+        return -ENOBUFS;
+    }
+    if (info != NULL) {
+        netdev2_ieee802154_rx_info_t *radio_info = info;
+        radio_info->rssi = 255;
+        radio_info->lqi = 35;
+    }
+    memcpy(buf, rx_frame, rx_frame_len);
+    sema_post(&sync);
+    return rx_frame_len;
+}
+
+/* length of an IPHC header without contexts (RFC 6282), -1 if the next
+ * header is not ICMPv6 carried inline */
+static int _iphc_icmpv6_len(const uint8_t *iphc, size_t len)
+{
+    static const uint8_t tf_len[] = { 4, 3, 1, 0 };
+    static const uint8_t addr_len[] = { 16, 8, 2, 0 };
+    static const uint8_t mcast_len[] = { 16, 6, 4, 1 };
+    size_t res = 2;
+    uint8_t nh;
+
+    if ((len < 3) || (iphc[0] & SIXLOWPAN_IPHC1_NH)) {
+        return -1;
+    }
+    if (iphc[1] & SIXLOWPAN_IPHC2_CID_EXT) {
+        res++;
+    }
+    res += tf_len[(iphc[0] & SIXLOWPAN_IPHC1_TF) >> 3];
+    if (res >= len) {
+        return -1;
+    }
+    nh = iphc[res++];
+    if ((iphc[0] & SIXLOWPAN_IPHC1_HL) == 0) {
+        res++;
+    }
+    /* SAC with SAM 00 is the unspecified address */
+    if (!(iphc[1] & SIXLOWPAN_IPHC2_SAC) || (iphc[1] & SIXLOWPAN_IPHC2_SAM)) {
+        res += addr_len[(iphc[1] & SIXLOWPAN_IPHC2_SAM) >> 4];
+    }
+    if (iphc[1] & SIXLOWPAN_IPHC2_M) {
+        res += (iphc[1] & SIXLOWPAN_IPHC2_DAC) ? 6 :
+               mcast_len[iphc[1] & SIXLOWPAN_IPHC2_DAM];
+    }
+    else {
+        res += addr_len[iphc[1] & SIXLOWPAN_IPHC2_DAM];
+    }
+    return (nh == PROTNUM_ICMPV6) ? (int)res : -1;
+}
+
+/* classifies a frame sent by the node and has the root react to it */
+static int _classify(const uint8_t *frame, size_t len)
+{
+    size_t offset = ieee802154_get_frame_hdr_len(frame);
+    const uint8_t *icmp;
+    bool fragmented = false;
+    int hdr_len, res = CTRL_OTHER;
+
+    if (offset >= len) {
+        return CTRL_OTHER;
+    }
+    if ((frame[offset] & 0xf8) == SIXLOWPAN_FRAG_N_DISP) {
+        /* the node only fragments one datagram at a time */
+        return frag_ctrl;
+    }
+    if ((frame[offset] & 0xf8) == SIXLOWPAN_FRAG_1_DISP) {
+        offset += sizeof(sixlowpan_frag_t);
+        fragmented = true;
+    }
+    if ((offset < len) &&
+        ((frame[offset] & 0xe0) == SIXLOWPAN_IPHC1_DISP) &&
+        ((hdr_len = _iphc_icmpv6_len(&frame[offset], len - offset)) > 0) &&
+        ((offset + hdr_len + ICMPV6_HDR_LEN) <= len) &&
+        (frame[offset + hdr_len] == ICMPV6_RPL)) {
+        msg_t msg;
+
+        icmp = &frame[offset + hdr_len];
+        switch (icmp[1]) {
+            case RPL_DIS:
+                msg.type = MSG_TYPE_DIO;
+                msg.content.value = 1;
+                msg_try_send(&msg, main_pid);
+                res = CTRL_DIS;
+                break;
+            case RPL_DIO:
+                res = CTRL_DIO;
+                break;
+            case RPL_DAO:
+                if (!dao_sent) {
+                    first_dao = xtimer_now();
+                    dao_sent = true;
+                }
+                if (((offset + hdr_len + RPL_DAO_LEN) <= len) &&
+                    (icmp[5] & RPL_DAO_K_FLAG)) {
+                    msg.type = MSG_TYPE_DAO_ACK;
+                    msg.content.value = (icmp[4] << 8) | icmp[7];
+                    msg_try_send(&msg, main_pid);
+                }
+                res = CTRL_DAO;
+                break;
+            default:
+                break;
+        }
+    }
+    if (fragmented) {
+        frag_ctrl = res;
+    }
+    return res;
+}
+
+static int _netdev_send(netdev2_t *dev, const struct iovec *vector, int count)
+{
+    uint8_t frame[FRAME_MAX_LEN];
+    size_t len = 0;
+    int res = 0, ctrl;
+
+    (void)dev;
+    for (int i = 0; i < count; i++) {
+        size_t part = min(vector[i].iov_len, sizeof(frame) - len);
+
+        memcpy(&frame[len], vector[i].iov_base, part);
+        len += part;
+        res += vector[i].iov_len;
+    }
+    ctrl = _classify(frame, len);
+    ctrl_stats.frames[ctrl]++;
+    ctrl_stats.bytes[ctrl] += res;
+    return res;
+}
+
+/* hands an ICMPv6 message of the root to the node */
+static void _root_send(const uint8_t *dst_l2, size_t dst_l2_len,
+                       const ipv6_addr_t *dst, uint8_t *icmp, size_t icmp_len)
+{
+    const le_uint16_t pan_id = byteorder_btols(byteorder_htons(NETDEV_PAN_ID));
+    const bool multicast = (dst->u8[0] == 0xff);
+    ipv6_hdr_t pseudo_hdr;
+    network_uint16_t chksum;
+    uint8_t *ptr;
+
+    /* both addresses are derived from the link layer */
+    ptr = rx_frame + ieee802154_set_frame_hdr(rx_frame, root_l2, sizeof(root_l2),
+                                              dst_l2, dst_l2_len, pan_id, pan_id,
+                                              IEEE802154_FCF_TYPE_DATA |
+                                              (multicast ? 0 : IEEE802154_FCF_ACK_REQ),
+                                              rx_seq++);
+    *(ptr++) = SIXLOWPAN_IPHC1_DISP | SIXLOWPAN_IPHC1_TF | SIXLOWPAN_IPHC1_HL;
+    if (multicast) {
+        *(ptr++) = SIXLOWPAN_IPHC2_SAM | SIXLOWPAN_IPHC2_M | SIXLOWPAN_IPHC2_DAM;
+        *(ptr++) = PROTNUM_ICMPV6;
+        *(ptr++) = dst->u8[15];
+    }
+    else {
+        *(ptr++) = SIXLOWPAN_IPHC2_SAM | SIXLOWPAN_IPHC2_DAM;
+        *(ptr++) = PROTNUM_ICMPV6;
+    }
+    memcpy(&pseudo_hdr.src, &root_ll, sizeof(root_ll));
+    memcpy(&pseudo_hdr.dst, dst, sizeof(ipv6_addr_t));
+    icmp[2] = 0;
+    icmp[3] = 0;
+    chksum = byteorder_htons(~ipv6_hdr_inet_csum(csum_inet(0, icmp, icmp_len),
+                                                 &pseudo_hdr, PROTNUM_ICMPV6,
+                                                 icmp_len));
+    memcpy(&icmp[2], &chksum, sizeof(chksum));
+    memcpy(ptr, icmp, icmp_len);
+    rx_frame_len = (ptr - rx_frame) + icmp_len;
+    netdev->event_callback(netdev, NETDEV2_EVENT_ISR);
+    sema_wait(&sync);   /* wait for frame to be received */
+}
+
+static void _send_dio(void)
+{
+    _root_send(bcast_l2, sizeof(bcast_l2), &all_rpl_nodes, dio, sizeof(dio));
+}
+
+static void _send_dao_ack(uint32_t value)
+{
+    uint8_t dao_ack[] = { ICMPV6_RPL, RPL_DAO_ACK, 0x00, 0x00,
+                          value >> 8, 0x00, value & 0xff, 0x00 };
+
+    _root_send(node_l2, sizeof(node_l2), &node_ll, dao_ack, sizeof(dao_ack));
+}
+
+static void _ctrl_snapshot(ctrl_stats_t *stats)
+{
+    unsigned state = disableIRQ();
+
+    memcpy(stats, &ctrl_stats, sizeof(ctrl_stats_t));
+    memset(&ctrl_stats, 0, sizeof(ctrl_stats));
+    restoreIRQ(state);
+}
+
+static void _ctrl_print(const char *phase, uint32_t duration,
+                        const ctrl_stats_t *stats)
+{
+    printf("%s,%" PRIu32, phase, duration);
+    for (unsigned i = 0; i < CTRL_NUMOF; i++) {
+        printf(",%u,%u", stats->frames[i], stats->bytes[i]);
+    }
+    puts("");
+}
+
+#ifdef MODULE_SCHEDSTATISTICS
+static void _cpu_snapshot(void)
+{
+    for (kernel_pid_t i = 0; i <= KERNEL_PID_LAST; i++) {
+        cpu_start[i] = sched_pidlist[i].runtime_ticks;
+        schedules_start[i] = sched_pidlist[i].schedules;
+    }
+}
+
+/* main is left out, it simulates the root */
+static void _cpu_print(uint32_t duration)
+{
+    uint64_t total = 0;
+
+    puts("task,cpu_us,cpu_us_per_min,schedules");
+    for (kernel_pid_t i = 0; i <= KERNEL_PID_LAST; i++) {
+        const thread_t *p = (thread_t *)sched_threads[i];
+        uint64_t cpu;
+
+        if ((p == NULL) ||
+            (strcmp(p->name, "idle") == 0) ||
+            (strcmp(p->name, "main") == 0)) {
+            continue;
+        }
+        cpu = sched_pidlist[i].runtime_ticks - cpu_start[i];
+        total += cpu;
+        printf("%s,%" PRIu32 ",%" PRIu32 ",%u\n", p->name, (uint32_t)cpu,
+               (uint32_t)((cpu * 60000000U) / duration),
+               sched_pidlist[i].schedules - schedules_start[i]);
+    }
+    printf("total,%" PRIu32 ",%" PRIu32 ",\n", (uint32_t)total,
+           (uint32_t)((total * 60000000U) / duration));
+}
+#endif
+
+void exp_run(void)
+{
+    ipv6_addr_t prefix = EXP_PREFIX;
+    msg_t msg, dio_msg, poll_msg, end_msg;
+    xtimer_t dio_timer, poll_timer, end_timer;
+    ctrl_stats_t join_stats, steady_stats;
+    uint32_t start, route = 0;
+    bool joined = false, done = false;
+
+    main_pid = thread_getpid();
+    node_l2[7] = 0;
+    ipv6_addr_set_link_local_prefix(&node_ll);
+    memcpy(&node_ll.u64[1], node_l2, sizeof(node_ll.u64[1]));
+    node_ll.u8[8] ^= 0x02;
+    ipv6_addr_init_prefix(&dodag_id, &prefix, RPL_PREFIX_LEN);
+    memcpy(&dio[DIO_DODAG_ID], &dodag_id, sizeof(dodag_id));
+    memcpy(&dio[DIO_PREFIX], &dodag_id, sizeof(dodag_id));
+    netdev2_test_set_isr_cb(&netdevs[0], _netdev_isr);
+    netdev2_test_set_recv_cb(&netdevs[0], _netdev_recv);
+    netdev2_test_set_send_cb(&netdevs[0], _netdev_send);
+    /* like the other experiments, address resolution is not measured */
+    stack_add_neighbor(0, &root_ll, root_l2, sizeof(root_l2));
+
+    dio_msg.type = MSG_TYPE_DIO;
+    dio_msg.content.value = 0;
+    poll_msg.type = MSG_TYPE_POLL;
+    end_msg.type = MSG_TYPE_END;
+    start = xtimer_now();
+    stack_init_rpl(0, &dodag_id);
+    /* the reboot of the node does not reset the trickle timer of the root */
+    xtimer_set_msg(&dio_timer, EXP_RPL_DIO_INTERVAL, &dio_msg, main_pid);
+    xtimer_set_msg(&poll_timer, EXP_RPL_POLL, &poll_msg, main_pid);
+    xtimer_set_msg(&end_timer, EXP_RPL_TIMEOUT, &end_msg, main_pid);
+    while (!done) {
+        msg_receive(&msg);
+        switch (msg.type) {
+            case MSG_TYPE_DIO:
+                _send_dio();
+                if (msg.content.value == 0) {
+                    xtimer_set_msg(&dio_timer, EXP_RPL_DIO_INTERVAL, &dio_msg,
+                                   main_pid);
+                }
+                break;
+            case MSG_TYPE_DAO_ACK:
+                _send_dao_ack(msg.content.value);
+                break;
+            case MSG_TYPE_POLL:
+                if (!stack_has_route(&dodag_id)) {
+                    xtimer_set_msg(&poll_timer, EXP_RPL_POLL, &poll_msg,
+                                   main_pid);
+                    break;
+                }
+                route = xtimer_now() - start;
+                joined = true;
+                _ctrl_snapshot(&join_stats);
+#ifdef MODULE_SCHEDSTATISTICS
+                _cpu_snapshot();
+#endif
+                xtimer_remove(&end_timer);
+                xtimer_set_msg(&end_timer, EXP_RPL_STEADY, &end_msg, main_pid);
+                break;
+            case MSG_TYPE_END:
+                done = true;
+                break;
+            default:
+                break;
+        }
+    }
+    xtimer_remove(&dio_timer);
+    xtimer_remove(&poll_timer);
+    if (!joined) {
+        _ctrl_snapshot(&join_stats);
+        printf("# no route to the DODAG root after %u us\n",
+               (unsigned)EXP_RPL_TIMEOUT);
+    }
+    else {
+        _ctrl_snapshot(&steady_stats);
+    }
+    puts("route_us,dao_us");
+    if (joined) {
+        printf("%" PRIu32, route);
+    }
+    if (dao_sent) {
+        printf(",%" PRIu32 "\n", first_dao - start);
+    }
+    else {
+        puts(",");
+    }
+    puts("phase,duration_us,dis_frames,dis_bytes,dio_frames,dio_bytes,"
+         "dao_frames,dao_bytes,other_frames,other_bytes");
+    _ctrl_print("join", joined ? route : EXP_RPL_TIMEOUT, &join_stats);
+    if (joined) {
+        _ctrl_print("steady", EXP_RPL_STEADY, &steady_stats);
+#ifdef MODULE_SCHEDSTATISTICS
+        _cpu_print(EXP_RPL_STEADY);
+#endif
+    }
+#ifdef EXP_STACKTEST
+    puts("thread,stack_size,stack_free");
+    for (kernel_pid_t i = 0; i <= KERNEL_PID_LAST; i++) {
+        const thread_t *p = (thread_t *)sched_threads[i];
+        if ((p != NULL) &&
+            (strcmp(p->name, "idle") != 0) &&
+            (strcmp(p->name, "main") != 0)) {
+            printf("%s,%u,%u\n", p->name, p->stack_size,
+                   thread_measure_stack_free(p->stack_start));
+        }
+    }
+#endif
+}
+
+/** @} */
@@ -7,48 +7,78 @@
 # Distributed under terms of the MIT license.
 
 import os
-import pexpect
+import re
 import sys
 import time
 
+# pexpect is imported by the functions using IoT-LAB, so the tools only
+# importing the experiments from here (run_native.py, build.py,
+# size_report.py) do not need it
 MAX_EXP_MINUTES=12
 
 EMPTY_APP_PATH = "../empty/"
-APPS = ['time_tx', 'time_tx_rpl', 'time_rx', 'time_rx_rpl']
+APPS = ['time_tx', 'time_tx_rpl', 'time_rx', 'time_rx_rpl', 'time_tx_multi',
+        'time_fwd', 'rpl_conv', 'time_tx_fib', 'time_tx_nc']
 STACKS = ['emb6', 'gnrc', 'lwip']
 NON_RPL_STACKS = ['lwip']
+NON_FWD_STACKS = ['lwip']
+SINGLE_IFACE_STACKS = ['emb6']
 IOTLAB_USER = 'lenders'
 IOTLAB_SITE = 'paris'
-IOTLAB_NODE = 43
+IOTLAB_NODES = [43, 44, 45, 46]
 IOTLAB_EXP_NAME = 'masterthesis_run'
-IOTLAB_DURATION = 2 * MAX_EXP_MINUTES * len(APPS) * len(STACKS)
+
+def experiments(apps=APPS, stacks=STACKS):
+    for app in apps:
+        for stack in stacks:
+            if ('rpl' in app.split('_')) and (stack in NON_RPL_STACKS):
+                continue
+            if (app[-5:] == 'multi') and (stack in SINGLE_IFACE_STACKS):
+                continue
+            if (app[-3:] in ('fwd', 'fib')) and (stack in NON_FWD_STACKS):
+                continue
+            yield app, stack
+
+# the experiments are sharded over the nodes
+IOTLAB_DURATION = 2 * MAX_EXP_MINUTES * \
+        -(-len(list(experiments())) // len(IOTLAB_NODES))
+
+# serial_aggregator prefixes every line with "<timestamp>;<node>;"
+SERIAL_LINE = re.compile(r"[^;\r\n]*;m3-(?P<node>\d+);(?P<line>[^\r\n]*)\r?\n")
 
 MINUTE=60
 MAX_BUILD_TIME=5 * MINUTE
 MAX_EXP_TIME=MAX_EXP_MINUTES * MINUTE
 
-def build(stacktest=False):
+def build(stacktest=False, flow=False, pktbuf=False, lpm=False,
+          nc_hash=False, emb6_event=False):
+    from build import build_all, report
     env = os.environ
-    env.update({'STACKTEST': str(int(bool(stacktest)))})
-    make = pexpect.spawn("make -B clean all", env=env, timeout=MAX_BUILD_TIME)
+    env.update({'STACKTEST': str(int(bool(stacktest))),
+                'FLOW': str(int(bool(flow))),
+                'PKTBUF': str(int(bool(pktbuf))),
+                'LPM': str(int(bool(lpm))),
+                'NC_HASH': str(int(bool(nc_hash))),
+                'EMB6_EVENT': str(int(bool(emb6_event)))})
+    print("Building%s%s%s%s%s%s" % (" (stacktest)" if stacktest else "",
+                                    " (flow)" if flow else "",
+                                    " (pktbuf)" if pktbuf else "",
+                                    " (lpm)" if lpm else "",
+                                    " (nc_hash)" if nc_hash else "",
+                                    " (emb6_event)" if emb6_event else ""))
     start = time.time()
-    for app in APPS:
-        for stack in STACKS:
-            if (app[-3:] == 'rpl') and (stack in NON_RPL_STACKS):
-                continue
-            sys.stdout.write("Building %s_%s%s" %
-                             (stack, app, " (stacktest)" if stacktest else ""))
-            sys.stdout.flush()
-            make.expect(r"/%s_%s\.elf\s*$" % (stack, app))
-            print("... done")
+    results = build_all(list(experiments()), env)
     duration = time.time() - start
-    make.wait()
+    report(results)
     print("Building took %.2f minutes" % (duration / MINUTE))
+    if any(r[2] == "failed" for r in results):
+        raise RuntimeError("Building failed")
 
-def start_exp(site, node, duration, iotlab_exp_name):
+def start_exp(site, nodes, duration, iotlab_exp_name):
+    import pexpect
     env = os.environ
     env.update({ 'IOTLAB_SITE': str(site),
-                 'IOTLAB_PHY_NODES': str(node),
+                 'IOTLAB_PHY_NODES': "+".join(str(node) for node in nodes),
                  'IOTLAB_DURATION': str(duration),
                  'IOTLAB_EXP_NAME': str(iotlab_exp_name)})
     make = pexpect.spawn("make -C %s iotlab-exp" % EMPTY_APP_PATH, env=env,
@@ -62,6 +92,7 @@ def start_exp(site, node, duration, iotlab_exp_name):
     return iotlab_exp_id
 
 def stop_exp(iotlab_exp_id=None):
+    import pexpect
     env = os.environ
     if iotlab_exp_id != None:
         env.update({'IOTLAB_EXP_ID': str(iotlab_exp_id)})
@@ -72,24 +103,49 @@ def stop_exp(iotlab_exp_id=None):
     IOTLAB_EXP_ID = 0
     print("Stopped experiment %d" % iotlab_exp_id)
 
-def flash(path, iotlab_exp_id):
-    print("Flashing %s" % path)
+def flash(path, iotlab_exp_id, node):
+    import pexpect
+    print("Flashing %s on m3-%d" % (path, node))
     env = os.environ
-    env.update({'IOTLAB_EXP_ID': str(iotlab_exp_id)})
+    env.update({'IOTLAB_EXP_ID': str(iotlab_exp_id),
+                'IOTLAB_PHY_NODES': str(node)})
     make = pexpect.spawn("make -C %s iotlab-flash" % path, env=env,
                          timeout=MINUTE)
     make.expect("\"0\": \\[")
     make.expect("\"m3-\\d+.\\w+.iot-lab.info\"")
     make.wait()
-    print("Flashed %s" % path)
+    print("Flashed %s on m3-%d" % (path, node))
 
-def run_experiments(site, node, iotlab_exp_id, stacktest=False):
+def run_experiments(site, nodes, iotlab_exp_id, stacktest=False, flow=False,
+                    pktbuf=False, lpm=False, nc_hash=False, emb6_event=False):
+    import pexpect
     env = os.environ
-    env.update({'STACKTEST': str(int(bool(stacktest)))})
+    env.update({'STACKTEST': str(int(bool(stacktest))),
+                'FLOW': str(int(bool(flow))),
+                'PKTBUF': str(int(bool(pktbuf))),
+                'LPM': str(int(bool(lpm))),
+                'NC_HASH': str(int(bool(nc_hash))),
+                'EMB6_EVENT': str(int(bool(emb6_event)))})
     if stacktest:
-        log_name = "stackusage_%s-%d-%d-%d.txt" % (site, node, iotlab_exp_id, time.time())
+        kind = "stackusage"
+    elif pktbuf:
+        kind = "pktbuf"
+    elif flow:
+        kind = "times_flow"
+    elif lpm:
+        kind = "times_lpm"
+    elif nc_hash:
+        kind = "times_nc_hash"
+    elif emb6_event:
+        kind = "times_emb6_event"
     else:
-        log_name = "times_%s-%d-%d-%d.txt" % (site, node, iotlab_exp_id, time.time())
+        kind = "times"
+    now = time.time()
+    log_name = "%s_%s-%d-%d.txt" % (kind, site, iotlab_exp_id, now)
+    # the output of the nodes is demultiplexed into one log per node
+    node_logs = dict((node, open("%s_%s-%d-%d-%d.txt" %
+                                 (kind, site, node, iotlab_exp_id, now), "w"))
+                     for node in nodes)
     logger = pexpect.spawn("/bin/bash", ['-c',
                            "ssh %s@%s.iot-lab.info " % (IOTLAB_USER, site) +
                             "\"tmux -c 'serial_aggregator -i %d &> %s'\"" %
@@ -98,17 +154,41 @@ def run_experiments(site, node, iotlab_exp_id, stacktest=False):
     watcher = pexpect.spawn("ssh %s@%s.iot-lab.info 'tail -F %s'" %
                             (IOTLAB_USER, site, log_name), timeout=MAX_EXP_TIME)
 
-    for app in APPS:
-        for stack in STACKS:
-            if (app[-3:] == 'rpl') and (stack in NON_RPL_STACKS):
-                continue
-            flash("%s/%s" % (app, stack), iotlab_exp_id)
-            start = time.time()
-            watcher.expect("%s_%s stopped" % (stack, app))
-            duration = time.time() - start
-            print("%s_%s%s ran for %.2f minutes" %
-                  (stack, app, " (stacktest)" if stacktest else "",
-                  duration / MINUTE))
+    queue = list(experiments())
+    idle = list(nodes)
+    running = {}
+    while queue or running:
+        # flash every idle node as soon as it finished its experiment
+        while queue and idle:
+            node = idle.pop(0)
+            app, stack = queue.pop(0)
+            flash("%s/%s" % (app, stack), iotlab_exp_id, node)
+            running[node] = (app, stack, time.time())
+        if watcher.expect([SERIAL_LINE, pexpect.TIMEOUT], timeout=MINUTE) == 0:
+            node = int(watcher.match.group("node"))
+            line = watcher.match.group("line")
+            if node in node_logs:
+                node_logs[node].write("%s\n" % line)
+            exp = running.get(node)
+            if (exp is not None) and \
+               (line.strip() == "%s_%s stopped" % (exp[1], exp[0])):
+                app, stack, start = running.pop(node)
+                idle.append(node)
+                print("%s_%s%s%s%s%s%s%s ran for %.2f minutes on m3-%d" %
+                      (stack, app, " (stacktest)" if stacktest else "",
+                       " (flow)" if flow else "",
+                       " (pktbuf)" if pktbuf else "",
+                       " (lpm)" if lpm else "",
+                       " (nc_hash)" if nc_hash else "",
+                       " (emb6_event)" if emb6_event else "",
+                       (time.time() - start) / MINUTE, node))
+        for node, (app, stack, start) in list(running.items()):
+            if (time.time() - start) > MAX_EXP_TIME:
+                del running[node]
+                idle.append(node)
+                print("%s_%s timed out on m3-%d" % (stack, app, node))
+    for log in node_logs.values():
+        log.close()
     watcher.terminate()
     watcher.wait()
     logger.terminate()
@@ -117,11 +197,32 @@ def run_experiments(site, node, iotlab_exp_id, stacktest=False):
 if __name__ == "__main__":
     os.chdir(os.path.dirname(sys.argv[0]))
     build(True)
-    IOTLAB_EXP_ID = start_exp(IOTLAB_SITE, IOTLAB_NODE, IOTLAB_DURATION,
+    IOTLAB_EXP_ID = start_exp(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_DURATION,
                               IOTLAB_EXP_NAME)
     try:
-        run_experiments(IOTLAB_SITE, IOTLAB_NODE, IOTLAB_EXP_ID, True)
+        run_experiments(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_EXP_ID, True)
         # build(True)
-        # run_experiments(IOTLAB_SITE, IOTLAB_NODE, IOTLAB_EXP_ID, True)
+        # run_experiments(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_EXP_ID, True)
+        # gain of the precomputed IPHC header: compare with a run of
+        # build(False) and run_experiments(..., False)
+        # build(False, True)
+        # run_experiments(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_EXP_ID, False, True)
+        # peak packet buffer usage per payload size:
+        # build(pktbuf=True)
+        # run_experiments(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_EXP_ID, pktbuf=True)
+        # route lookup with the trie index (time_tx_fib), compare with
+        # build(False):
+        # build(lpm=True)
+        # run_experiments(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_EXP_ID, lpm=True)
+        # address resolution with the hashed neighbor cache (time_tx_nc),
+        # compare with build(False):
+        # build(nc_hash=True)
+        # run_experiments(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_EXP_ID,
+        #                 nc_hash=True)
+        # emb6 woken by its events instead of polling every EMB6_DELAY (only
+        # the emb6 results differ), compare with build(False):
+        # build(emb6_event=True)
+        # run_experiments(IOTLAB_SITE, IOTLAB_NODES, IOTLAB_EXP_ID,
+        #                 emb6_event=True)
     finally:
         stop_exp(IOTLAB_EXP_ID)
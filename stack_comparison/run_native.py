@@ -0,0 +1,146 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+#
+# Copyright © 2016 Martine Lenders <mail@martine-lenders.eu>
+#
+# Distributed under terms of the MIT license.
+
+"""
+Builds the experiments for RIOT's native board and runs them locally in
+parallel. The radio is mocked by netdev2_test anyway, so no hardware is
+needed. The output of every experiment is stored in
+results/<revision>/<stack>_<app>.txt.
+"""
+
+import argparse
+import multiprocessing
+import os
+import signal
+import subprocess
+import sys
+import threading
+import time
+
+from run import APPS, STACKS, MAX_EXP_TIME, MINUTE, experiments
+
+BOARD = 'native'
+RESULTS_PATH = 'results'
+
+def revision():
+    try:
+        return subprocess.check_output(['git', 'describe', '--always',
+                                        '--dirty']).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return time.strftime('%Y%m%d%H%M%S')
+
+def app_name(app, stack):
+    return "%s_%s" % (stack, app)
+
+def elf_path(app, stack):
+    return os.path.join(app, stack, 'bin', BOARD, "%s.elf" % app_name(app, stack))
+
+def build_stack(args):
+    """builds all apps of a stack sequentially, since the package sources of
+    a stack are shared by its apps"""
+    stack, apps, env = args
+    failed = []
+    for app in apps:
+        path = os.path.join(app, stack)
+        with open(os.devnull, 'w') as devnull:
+            res = subprocess.call(['make', '-C', path, 'all'], env=env,
+                                  stdout=devnull, stderr=subprocess.STDOUT)
+        if res != 0:
+            failed.append(app)
+    return stack, failed
+
+def kill(proc):
+    try:
+        os.killpg(proc.pid, signal.SIGKILL)
+    except OSError:
+        pass
+
+def run_experiment(args):
+    app, stack, log_path, timeout = args
+    stop = "%s stopped" % app_name(app, stack)
+    start = time.time()
+    res = False
+    with open(log_path, 'w') as log:
+        try:
+            proc = subprocess.Popen([elf_path(app, stack)],
+                                    stdout=subprocess.PIPE,
+                                    stderr=subprocess.STDOUT,
+                                    universal_newlines=True,
+                                    preexec_fn=os.setsid)
+        except OSError as e:
+            log.write("# %s\n" % e)
+            return app, stack, res, time.time() - start
+        # also kills an experiment that hangs without output
+        watchdog = threading.Timer(timeout, kill, [proc])
+        watchdog.start()
+        try:
+            # native keeps running after main() returned
+            for line in iter(proc.stdout.readline, ''):
+                log.write(line)
+                if stop in line:
+                    res = True
+                    break
+        finally:
+            watchdog.cancel()
+            kill(proc)
+            proc.wait()
+    return app, stack, res, time.time() - start
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-a', '--apps', nargs='+', default=APPS,
+                        choices=APPS)
+    parser.add_argument('-s', '--stacks', nargs='+', default=STACKS,
+                        choices=STACKS)
+    parser.add_argument('-j', '--jobs', type=int,
+                        default=multiprocessing.cpu_count())
+    parser.add_argument('-o', '--output', default=None,
+                        help="results directory (default: %s/<revision>)" %
+                             RESULTS_PATH)
+    parser.add_argument('-n', '--no-build', action='store_true')
+    parser.add_argument('-t', '--timeout', type=float,
+                        default=MAX_EXP_TIME / MINUTE,
+                        help="maximum minutes per experiment")
+    args = parser.parse_args()
+
+    env = dict(os.environ)
+    env.update({'BOARD': BOARD})
+    exps = list(experiments(args.apps, args.stacks))
+    output = args.output or os.path.join(RESULTS_PATH, revision())
+    if not os.path.isdir(output):
+        os.makedirs(output)
+    pool = multiprocessing.Pool(args.jobs)
+    failed = []
+
+    if not args.no_build:
+        start = time.time()
+        jobs = [(stack, [a for a, s in exps if s == stack], env)
+                for stack in args.stacks]
+        for stack, apps in pool.map(build_stack, jobs):
+            for app in apps:
+                print("Building %s failed" % app_name(app, stack))
+                failed.append((app, stack))
+        print("Building took %.2f minutes" % ((time.time() - start) / MINUTE))
+    exps = [e for e in exps if e not in failed]
+    jobs = [(app, stack,
+             os.path.join(output, "%s.txt" % app_name(app, stack)),
+             args.timeout * MINUTE) for app, stack in exps]
+    for app, stack, res, duration in pool.imap_unordered(run_experiment, jobs):
+        print("%s %s after %.2f minutes" %
+              (app_name(app, stack), "stopped" if res else "failed",
+               duration / MINUTE))
+        if not res:
+            failed.append((app, stack))
+    pool.close()
+    pool.join()
+    print("Results are in %s" % output)
+    return 1 if failed else 0
+
+if __name__ == "__main__":
+    os.chdir(os.path.dirname(os.path.abspath(sys.argv[0])))
+    sys.exit(main())
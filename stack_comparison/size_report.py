@@ -0,0 +1,262 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+#
+# Copyright © 2016 Martine Lenders <mail@martine-lenders.eu>
+#
+# Distributed under terms of the MIT license.
+
+"""
+Breaks the ROM/RAM footprint of the built experiments down by RIOT module
+and compares it across the stacks.
+
+Every input section of the linker map (see LINKFLAGS in
+time_tx/Makefile.common) is attributed to the module archive it was linked
+from. Output sections count as text, data or bss like for size(1). Modules
+are grouped into
+
+    app         the experiment itself
+    stack       gnrc_*, lwip*, emb6* (the network stack under comparison)
+    riot        kernel, drivers, sys and shared network modules
+    toolchain   libc, libgcc, crt objects
+    other       linker fill and everything not found in the map
+
+With --store the breakdown is stored in results.db for --history.
+"""
+
+import argparse
+import collections
+import os
+import re
+import subprocess
+import sys
+
+from run import APPS, STACKS
+from results import DB_PATH, add_run, connect, revision
+
+CATEGORIES = ["app", "stack", "riot", "toolchain", "other"]
+STACK_PREFIXES = ("gnrc", "lwip", "emb6")
+MAP_START = "Linker script and memory map"
+# " .text.foo 0x08000130 0x80 /path/bin/iotlab-m3/foo.a(foo.o)", the name can
+# be on the line before if it is too long
+INPUT_RE = re.compile(r"^ (?P<name>\S+)?\s+0x(?P<addr>[0-9a-fA-F]+)\s+"
+                      r"0x(?P<size>[0-9a-fA-F]+)(?:\s+(?P<file>\S.*))?$")
+ARCHIVE_RE = re.compile(r"^(?P<archive>.*)\((?P<member>[^()]*)\)$")
+
+Size = collections.namedtuple("Size", ["text", "data", "bss"])
+
+def tool(name, board):
+    return name if board == "native" else "arm-none-eabi-%s" % name
+
+def sections(elf, board):
+    """maps the allocated output sections to text, data or bss like size(1)
+    and sums them up"""
+    kinds = {}
+    total = dict(text=0, data=0, bss=0)
+    out = subprocess.check_output([tool("objdump", board), "-h", elf])
+    lines = out.decode().splitlines()
+    for i, line in enumerate(lines[:-1]):
+        fields = line.split()
+        if len(fields) < 7 or not fields[0].isdigit():
+            continue
+        flags = [f.strip() for f in lines[i + 1].split(",")]
+        if "ALLOC" not in flags:
+            continue
+        if "CODE" in flags or "READONLY" in flags:
+            kinds[fields[1]] = "text"
+        elif "LOAD" in flags:
+            kinds[fields[1]] = "data"
+        else:
+            kinds[fields[1]] = "bss"
+        total[kinds[fields[1]]] += int(fields[2], 16)
+    return kinds, Size(**total)
+
+def module(filename, bindir):
+    """name of the module an input file of the linker belongs to"""
+    match = ARCHIVE_RE.match(filename)
+    path = match.group("archive") if match else filename
+    # RIOT links from the application directory
+    path = os.path.normpath(os.path.join(bindir, "..", "..", path))
+    if os.path.dirname(path) == bindir and path.endswith(".a"):
+        return os.path.basename(path)[:-len(".a")]
+    if path.startswith(bindir + os.sep):
+        # object files of the application or of a module directory
+        return os.path.relpath(path, bindir).split(os.sep)[0]
+    name = os.path.basename(path)
+    return name[:-len(".a")] if name.endswith(".a") else "crt"
+
+def category(mod, application):
+    if mod == application:
+        return "app"
+    if mod.startswith(STACK_PREFIXES):
+        return "stack"
+    if mod.startswith("("):
+        return "other"
+    if mod == "crt" or mod.startswith("lib"):
+        return "toolchain"
+    return "riot"
+
+def parse_map(map_path, kinds, bindir):
+    """sums up the input sections of the linker map per module"""
+    sizes = collections.defaultdict(lambda: dict(text=0, data=0, bss=0))
+    output = None
+    pending = None
+    started = False
+    with open(map_path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not started:
+                started = line.startswith(MAP_START)
+                continue
+            if not line.strip():
+                continue
+            if not line[0].isspace():
+                output = line.split()[0]
+                pending = None
+                continue
+            match = INPUT_RE.match(line)
+            if match is None:
+                fields = line.split()
+                # wrapped input section name
+                pending = fields[0] if len(fields) == 1 else None
+                continue
+            name = match.group("name") or pending
+            pending = None
+            size = int(match.group("size"), 16)
+            if (output not in kinds) or (size == 0) or (name is None):
+                continue
+            if name == "*fill*":
+                mod = "(fill)"
+            elif match.group("file"):
+                mod = module(match.group("file"), bindir)
+            else:
+                continue
+            sizes[mod][kinds[output]] += size
+    return dict((mod, Size(**s)) for mod, s in sizes.items())
+
+def breakdown(app, stack, board):
+    """per-module sizes of a target, the remainder to size(1) is "(other)\""""
+    bindir = os.path.abspath(os.path.join(app, stack, "bin", board))
+    application = "%s_%s" % (stack, app)
+    elf = os.path.join(bindir, "%s.elf" % application)
+    map_path = os.path.join(bindir, "%s.map" % application)
+    if not (os.path.isfile(elf) and os.path.isfile(map_path)):
+        return None
+    kinds, total = sections(elf, board)
+    modules = parse_map(map_path, kinds, bindir)
+    rest = [getattr(total, k) - sum(getattr(s, k) for s in modules.values())
+            for k in Size._fields]
+    if any(rest):
+        modules["(other)"] = Size(*rest)
+    return dict((mod, (category(mod, application), size))
+                for mod, size in modules.items())
+
+def by_category(modules):
+    res = dict((c, [0, 0, 0]) for c in CATEGORIES)
+    for cat, size in modules.values():
+        for i, value in enumerate(size):
+            res[cat][i] += value
+    return dict((c, Size(*s)) for c, s in res.items())
+
+def rom(size):
+    return size.text + size.data
+
+def ram(size):
+    return size.data + size.bss
+
+def print_modules(app, stack, modules):
+    print("%s_%s" % (stack, app))
+    print("  %-32s %-9s %8s %8s %8s" % ("module", "category", "text", "data",
+                                        "bss"))
+    for mod, (cat, size) in sorted(modules.items(),
+                                   key=lambda m: -rom(m[1][1])):
+        print("  %-32s %-9s %8d %8d %8d" % ((mod, cat) + tuple(size)))
+    print("")
+
+def print_comparison(app, stacks, targets):
+    """one column pair (ROM/RAM) per stack, one row per category"""
+    cats = dict((stack, by_category(targets[stack])) for stack in stacks)
+    print(app)
+    print("  %-10s" % "category" +
+          "".join(" %8s %8s" % ("%s ROM" % s[:4], "%s RAM" % s[:4])
+                  for s in stacks))
+    for cat in CATEGORIES + ["total"]:
+        row = "  %-10s" % cat
+        for stack in stacks:
+            if cat == "total":
+                size = Size(*[sum(getattr(s, k) for s in cats[stack].values())
+                              for k in Size._fields])
+            else:
+                size = cats[stack][cat]
+            row += " %8d %8d" % (rom(size), ram(size))
+        print(row)
+    print("")
+
+def store(db, rev, board, targets):
+    run = add_run(db, rev, board, "module-sizes")
+    db.executemany("INSERT INTO module_sizes VALUES (?, ?, ?, ?, ?, ?, ?, ?)",
+                   [(run, stack, app, mod, cat) + tuple(size)
+                    for (app, stack), modules in sorted(targets.items())
+                    for mod, (cat, size) in sorted(modules.items())])
+    db.commit()
+
+def history(db, board, apps, stacks):
+    """ROM/RAM of the network stack per revision, latest import first"""
+    query = ("SELECT revision, stack, app, SUM(text + data), SUM(data + bss) "
+             "FROM module_sizes JOIN runs ON run = id "
+             "WHERE board = ? AND category = 'stack' "
+             "GROUP BY run, stack, app ORDER BY imported DESC, app, stack")
+    print("%-24s %-12s %-6s %8s %8s" % ("revision", "app", "stack", "ROM",
+                                        "RAM"))
+    for rev, stack, app, rom_size, ram_size in db.execute(query, (board,)):
+        if (app in apps) and (stack in stacks):
+            print("%-24s %-12s %-6s %8d %8d" % (rev, app, stack, rom_size,
+                                               ram_size))
+
+def main():
+    parser = argparse.ArgumentParser(
+            description=__doc__, formatter_class=argparse.RawTextHelpFormatter
+        )
+    parser.add_argument('-a', '--apps', nargs='+', default=APPS,
+                        choices=APPS)
+    parser.add_argument('-s', '--stacks', nargs='+', default=STACKS,
+                        choices=STACKS)
+    parser.add_argument('-b', '--board', default='iotlab-m3')
+    parser.add_argument('-m', '--modules', action='store_true',
+                        help="print the breakdown by module of every target")
+    parser.add_argument('--store', action='store_true',
+                        help="store the breakdown in the database")
+    parser.add_argument('--history', action='store_true',
+                        help="print the stored stack sizes per revision")
+    parser.add_argument('-r', '--revision', default=None)
+    parser.add_argument('-d', '--db', default=DB_PATH)
+    args = parser.parse_args()
+
+    if args.history:
+        history(connect(args.db), args.board, args.apps, args.stacks)
+        return 0
+    targets = {}
+    for app in args.apps:
+        for stack in args.stacks:
+            modules = breakdown(app, stack, args.board)
+            if modules is None:
+                continue
+            targets[app, stack] = modules
+            if args.modules:
+                print_modules(app, stack, modules)
+    if not targets:
+        print("No linker maps found, build with BOARD=%s first" % args.board)
+        return 1
+    for app in args.apps:
+        stacks = [s for s in args.stacks if (app, s) in targets]
+        if stacks:
+            print_comparison(app, stacks, dict((s, targets[app, s])
+                                               for s in stacks))
+    if args.store:
+        store(connect(args.db), args.revision or revision(), args.board,
+              targets)
+    return 0
+
+if __name__ == "__main__":
+    os.chdir(os.path.dirname(os.path.abspath(sys.argv[0])))
+    sys.exit(main())
@@ -0,0 +1,168 @@
+#! /usr/bin/env python
+# -*- coding: utf-8 -*-
+# vim:fenc=utf-8
+#
+# Copyright © 2016 Martine Lenders <mail@martine-lenders.eu>
+#
+# Distributed under terms of the MIT license.
+
+"""
+Generates <app>/<stack>/stacksizes.h with minimal thread stack sizes from the
+logs of STACKTEST=1 builds (see results.py for the log formats).
+
+The stack usage of a thread is the maximum over all logs, plus a safety
+margin. Threads that print results in the other builds additionally get
+THREAD_EXTRA_STACKSIZE_PRINTF, as STACKTEST=1 does not print them. Build with STACKSIZES=1 to use the header and additionally with
+STACKSIZES_RECLAIM=1 to add the RAM saved to the packet buffer. Sizes are
+only applied on the board the logs were taken on.
+"""
+
+import argparse
+import math
+import os
+import sys
+
+from results import LogParser
+
+HEADER = "stacksizes.h"
+ALIGN = 8
+# thread name -> stack size macro, threads sharing a macro get the maximum
+THREADS = {
+    "exp_sender": "EXP_STACKSIZE_EXP",
+    "exp_receiver": "EXP_STACKSIZE_EXP",
+    "netdev2": "EXP_STACKSIZE_MAC",
+    "probe": "EXP_STACKSIZE_PROBE",
+    "emb6": "EXP_STACKSIZE_EMB6",
+    "6lo": "GNRC_SIXLOWPAN_STACK_SIZE",
+    "flow": "GNRC_SIXLOWPAN_STACK_SIZE",
+    "ipv6": "GNRC_IPV6_STACK_SIZE",
+    "udp": "GNRC_UDP_STACK_SIZE",
+    "RPL": "GNRC_RPL_STACK_SIZE",
+}
+# threads that print results with output_record(), which STACKTEST=1 compiles
+# out, so they get THREAD_EXTRA_STACKSIZE_PRINTF on top of their usage
+PRINTF_THREADS = ("exp_receiver", "netdev2", "emb6")
+
+def align(size):
+    return int(math.ceil(float(size) / ALIGN)) * ALIGN
+
+def collect(logs):
+    """maximum usage and number of instances per (stack, app, thread)"""
+    usage = {}
+    for log in logs:
+        parser = LogParser()
+        with open(log) as f:
+            for line in f:
+                parser.feed(line)
+        counts = {}
+        for stack, app, thread, stack_size, stack_used in parser.stack_usage:
+            key = (stack, app, thread)
+            counts[key] = counts.get(key, 0) + 1
+            old = usage.get(key, (0, 0, 0))
+            usage[key] = (max(old[0], stack_size), max(old[1], stack_used),
+                          old[2])
+        # the same experiment in several logs does not add threads
+        for key, count in counts.items():
+            size, used, instances = usage[key]
+            usage[key] = (size, used, max(instances, count))
+    targets = {}
+    for (stack, app, thread), value in usage.items():
+        targets.setdefault((stack, app), {})[thread] = value
+    return targets
+
+def sizes(threads, margin):
+    """stack size per macro (without the thread control block and
+    THREAD_EXTRA_STACKSIZE_PRINTF), the macros that need the latter, the RAM
+    reclaimed by them and the number of threads the latter is to be subtracted
+    for"""
+    macros = {}
+    printf_macros = set()
+    for thread, (_, used, _) in threads.items():
+        if thread in THREADS:
+            macro = THREADS[thread]
+            macros[macro] = max(macros.get(macro, 0),
+                                align(used * (1.0 + margin)))
+            if thread in PRINTF_THREADS:
+                printf_macros.add(macro)
+    reclaimed = 0
+    printf_threads = 0
+    for thread, (size, _, instances) in threads.items():
+        if thread in THREADS:
+            reclaimed += (size - macros[THREADS[thread]]) * instances
+            if THREADS[thread] in printf_macros:
+                printf_threads += instances
+    return (macros, printf_macros, max(0, (reclaimed // ALIGN) * ALIGN),
+            printf_threads)
+
+def header(board, margin, threads, macros, printf_macros, reclaimed,
+           printf_threads):
+    board_macro = "BOARD_%s" % board.upper().replace("-", "_")
+    lines = ["/* generated by stacksize.py with a margin of %d%% from the "
+             "stack usage" % round(margin * 100),
+             " * measured on %s, do not edit */" % board,
+             "#ifndef STACKSIZES_H",
+             "#define STACKSIZES_H",
+             "",
+             "#ifdef %s" % board_macro]
+    for thread, (size, used, _) in sorted(threads.items()):
+        lines.append("/* %s: %d of %d bytes used%s */" %
+                     (thread, used, size,
+                      "" if thread in THREADS else ", not configurable"))
+    lines.append("")
+    for macro, size in sorted(macros.items()):
+        # the thread control block is part of the stack, but not of the
+        # measured stack size
+        lines.append("#define %-32s (%dU + sizeof(thread_t)%s)" %
+                     (macro, size,
+                      " + THREAD_EXTRA_STACKSIZE_PRINTF"
+                      if macro in printf_macros else ""))
+    if printf_threads > 0:
+        printf = "%dU * THREAD_EXTRA_STACKSIZE_PRINTF" % printf_threads
+        lines.append("#define %-32s ((%dU > (%s)) ? \\\n"
+                     "%-42s (%dU - (%s)) : 0U)" %
+                     ("EXP_STACKSIZE_RECLAIMED", reclaimed, printf, "",
+                      reclaimed, printf))
+    else:
+        lines.append("#define %-32s (%dU)" % ("EXP_STACKSIZE_RECLAIMED",
+                                             reclaimed))
+    lines.extend(["#else",
+                  "#define %-32s (0U)" % "EXP_STACKSIZE_RECLAIMED",
+                  "#endif",
+                  "",
+                  "#endif /* STACKSIZES_H */",
+                  ""])
+    return "\n".join(lines)
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-b', '--board', default='iotlab-m3',
+                        help="board the logs were taken on")
+    parser.add_argument('-m', '--margin', type=float, default=0.25,
+                        help="safety margin relative to the usage")
+    parser.add_argument('-n', '--dry-run', action='store_true',
+                        help="only print the headers")
+    parser.add_argument('logs', nargs='+')
+    args = parser.parse_args()
+
+    targets = collect(args.logs)
+    if not targets:
+        print("No stack usage found, run the experiments with STACKTEST=1")
+        return 1
+    base = os.path.dirname(os.path.abspath(__file__))
+    for (stack, app), threads in sorted(targets.items()):
+        macros, printf_macros, reclaimed, printf_threads = \
+            sizes(threads, args.margin)
+        content = header(args.board, args.margin, threads, macros,
+                         printf_macros, reclaimed, printf_threads)
+        path = os.path.join(base, app, stack, HEADER)
+        if args.dry_run or not os.path.isdir(os.path.dirname(path)):
+            print("%s_%s:\n%s" % (stack, app, content))
+            continue
+        with open(path, "w") as f:
+            f.write(content)
+        print("%s: %d bytes reclaimed" % (os.path.relpath(path, base),
+                                           reclaimed))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1 @@
+../../time_tx/gnrc/netdev.c
\ No newline at end of file
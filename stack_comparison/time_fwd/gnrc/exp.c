@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Forwarding latency of a router
+ *
+ * Datagrams to @ref EXP_FWD_DST are injected as 6LoWPAN fragments on
+ * `netdevs[0]` and captured after forwarding on the last device (the same
+ * device for the single interface of emb6). Neither stack forwards fragments,
+ * they reassemble the datagram and fragment it again. One of two latencies
+ * shows the cost of this: from the first fragment in to the first fragment
+ * out (`fwd_first`) or, with `EXP_FWD_LAST` (`FWD=last` on the make command
+ * line), from the last fragment in to the last fragment out (`fwd_last`).
+ *
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "sema.h"
+#include "net/ipv6.h"
+#include "net/protnum.h"
+#include "net/sixlowpan.h"
+#include "net/udp.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "csum.h"
+#include "flow.h"
+#include "netdev.h"
+#include "output.h"
+#include "stack.h"
+#include "timing.h"
+
+#include "exp.h"
+
+#define IEEE802154_MAX_FRAME_SIZE   (125U)
+#define MHR_LEN                     (23U)
+/* IPHC with inline addresses and the UDP LOWPAN_NHC header of flow.h */
+#define IPHC_LEN                    (2U + (2 * sizeof(ipv6_addr_t)) + \
+                                     FLOW_NHC_PORTS_LEN + sizeof(uint16_t))
+#define IPUDP_LEN                   (sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t))
+#define MAX_FRAGMENTS               (18)
+#define FRAG_HDR_MAX_LEN            (MHR_LEN + sizeof(sixlowpan_frag_t) + \
+                                     IPHC_LEN)
+#define FWD_IFACE_IN                (0)
+#define FWD_IFACE_OUT               (NETDEV_NUMOF - 1)
+
+/**
+ * @brief   Descriptor of a fragment, see time_rx
+ */
+typedef struct {
+    const uint8_t *data;    /**< slice of the datagram */
+    uint8_t hdr_len;        /**< length of the fragment's header */
+    uint8_t data_len;       /**< length of the slice */
+} frag_desc_t;
+
+static netdev2_t *const netdev = (netdev2_t *)&netdevs[FWD_IFACE_IN];
+static const uint8_t honeyguide[] = { 0x2d, 0x4e };
+static const uint8_t nhc_ports[] = { FLOW_NHC_PORTS };
+static const uint8_t src_l2[] = EXP_ADDR_L2;
+static uint8_t next_hop_l2[] = EXP_FWD_NEXT_HOP_L2;
+static uint8_t dst_l2[] = NETDEV_ADDR_PREFIX;
+static ipv6_addr_t src = EXP_ADDR;
+static ipv6_addr_t dst = EXP_FWD_DST;
+static uint8_t iphc[IPHC_LEN];
+static uint8_t uncomp_buffer[EXP_MAX_PAYLOAD + IPUDP_LEN];
+static uint8_t frag_hdr[MAX_FRAGMENTS][FRAG_HDR_MAX_LEN];
+static frag_desc_t frag_desc[MAX_FRAGMENTS];
+static unsigned frag_numof;
+static unsigned _pos;
+static uint16_t payload_size;
+static sema_t sync = SEMA_CREATE(0);
+static sema_t done = SEMA_CREATE(0);
+static volatile bool out_started;
+static volatile uint32_t first_out, last_out;
+
+#define HONEYGUIDE_LEN  (sizeof(honeyguide))
+
+#ifdef EXP_FWD_LAST
+#define FWD_METRIC      "fwd_last"
+#else
+#define FWD_METRIC      "fwd_first"
+#endif
+
+static inline int min(const int a, const int b)
+{
+    return (a < b) ? a : b;
+}
+
+static inline uint8_t *_sixlowpan_buf(uint8_t *buf)
+{
+    return buf + MHR_LEN;
+}
+
+static void _netdev_isr(netdev2_t *dev)
+{
+    dev->event_callback(dev, NETDEV2_EVENT_RX_COMPLETE);
+}
+
+static int _netdev_recv(netdev2_t *dev, char *buf, int len, void *info)
+{
+    const frag_desc_t *desc = &frag_desc[_pos];
+    const int frag_len = desc->hdr_len + desc->data_len;
+
+    (void)dev;
+    if (buf == NULL) {
+        return frag_len;
+    }
+    if (len < frag_len) {
+        sema_post(&sync);
+        return -ENOBUFS;
+    }
+    if (info != NULL) {
+        netdev2_ieee802154_rx_info_t *radio_info = info;
+        radio_info->rssi = 255;
+        radio_info->lqi = 35;
+    }
+    memcpy(buf, frag_hdr[_pos], desc->hdr_len);
+    memcpy(buf + desc->hdr_len, desc->data, desc->data_len);
+    sema_post(&sync);
+    return frag_len;
+}
+
+/* 6LoWPAN dispatch of a frame given as I/O vector */
+static uint8_t _dispatch(const struct iovec *vector, int count)
+{
+    size_t offset = ieee802154_get_frame_hdr_len(vector[0].iov_base);
+
+    for (int i = 0; i < count; i++) {
+        if (offset < vector[i].iov_len) {
+            return ((const uint8_t *)vector[i].iov_base)[offset];
+        }
+        offset -= vector[i].iov_len;
+    }
+    return 0;
+}
+
+static int _netdev_send(netdev2_t *dev, const struct iovec *vector, int count)
+{
+    const uint32_t now = timing_now();
+    const uint8_t *payload = vector[count - 1].iov_base;
+    const size_t payload_len = vector[count - 1].iov_len;
+    int res = 0;
+
+    (void)dev;
+    for (int i = 0; i < count; i++) {
+        res += vector[i].iov_len;
+    }
+    if (!out_started &&
+        ((_dispatch(vector, count) & 0xf8) == SIXLOWPAN_FRAG_1_DISP)) {
+        first_out = now;
+        out_started = true;
+    }
+    /* the honeyguide ends the datagram and only the datagram */
+    if ((payload_len >= HONEYGUIDE_LEN) &&
+        (memcmp(&payload[payload_len - HONEYGUIDE_LEN], honeyguide,
+                HONEYGUIDE_LEN) == 0)) {
+        if (!out_started) {     /* not fragmented */
+            first_out = now;
+            out_started = true;
+        }
+        last_out = now;
+        sema_post(&done);
+    }
+    return res;
+}
+
+static void _init_frag1(uint8_t *buf, unsigned size)
+{
+    sixlowpan_frag_t *frag1 = (sixlowpan_frag_t *)_sixlowpan_buf(buf);
+
+    frag1->disp_size = byteorder_htons(size);
+    frag1->disp_size.u8[0] &= ~SIXLOWPAN_FRAG_1_DISP;
+    frag1->disp_size.u8[0] |= SIXLOWPAN_FRAG_1_DISP;
+}
+
+static void _init_fragn(uint8_t *buf, unsigned size, unsigned offset)
+{
+    sixlowpan_frag_n_t *fragn = (sixlowpan_frag_n_t *)_sixlowpan_buf(buf);
+
+    fragn->disp_size = byteorder_htons(size);
+    fragn->disp_size.u8[0] &= ~SIXLOWPAN_FRAG_N_DISP;
+    fragn->disp_size.u8[0] |= SIXLOWPAN_FRAG_N_DISP;
+    fragn->offset = offset >> 3;
+}
+
+static void _set_tag(uint16_t tag)
+{
+    if (frag_numof > 1) {
+        for (unsigned i = 0; i < frag_numof; i++) {
+            sixlowpan_frag_t *f = (sixlowpan_frag_t *)_sixlowpan_buf(frag_hdr[i]);
+
+            f->tag = byteorder_htons(tag);
+        }
+    }
+}
+
+static void prepare_mhrs(void)
+{
+    const le_uint16_t pan_id = byteorder_btols(byteorder_htons(NETDEV_PAN_ID));
+
+    for (unsigned i = 0; i < MAX_FRAGMENTS; i++) {
+        ieee802154_set_frame_hdr(frag_hdr[i], src_l2, sizeof(src_l2),
+                                 dst_l2, sizeof(dst_l2), pan_id, pan_id,
+                                 IEEE802154_FCF_TYPE_DATA | IEEE802154_FCF_ACK_REQ,
+                                 i);
+    }
+}
+
+/* the datagram only changes with the payload size, the fragments only in the
+ * tag */
+static void prepare_datagram(void)
+{
+    ipv6_hdr_t *ipv6 = (ipv6_hdr_t *)uncomp_buffer;
+    udp_hdr_t *udp = (udp_hdr_t *)&uncomp_buffer[sizeof(ipv6_hdr_t)];
+    const uint8_t *data = &uncomp_buffer[IPUDP_LEN];
+    const uint8_t *end = data + payload_size;
+    const uint16_t length = payload_size + sizeof(udp_hdr_t);
+    unsigned offset = IPUDP_LEN;
+    uint16_t chksum;
+
+    memset(&uncomp_buffer[IPUDP_LEN], 0, payload_size);
+    memcpy(&uncomp_buffer[IPUDP_LEN + payload_size - HONEYGUIDE_LEN],
+           honeyguide, HONEYGUIDE_LEN);
+    memcpy(&ipv6->src, &src, sizeof(src));
+    memcpy(&ipv6->dst, &dst, sizeof(dst));
+    udp->src_port = byteorder_htons(EXP_SRC_PORT);
+    udp->dst_port = byteorder_htons(EXP_DST_PORT);
+    udp->length = byteorder_htons(length);
+    udp->checksum.u16 = 0;
+    chksum = ~ipv6_hdr_inet_csum(csum_inet(0, (uint8_t *)udp, length), ipv6,
+                                 PROTNUM_UDP, length);
+    if (chksum == 0) {
+        chksum = 0xffff;
+    }
+    udp->checksum = byteorder_htons(chksum);
+    memcpy(&iphc[IPHC_LEN - sizeof(uint16_t)], &udp->checksum,
+           sizeof(uint16_t));
+
+    if (payload_size <= (IEEE802154_MAX_FRAME_SIZE - MHR_LEN - IPHC_LEN)) {
+        memcpy(_sixlowpan_buf(frag_hdr[0]), iphc, IPHC_LEN);
+        frag_desc[0].hdr_len = MHR_LEN + IPHC_LEN;
+        frag_desc[0].data = data;
+        frag_desc[0].data_len = payload_size;
+        frag_numof = 1;
+        return;
+    }
+    for (frag_numof = 0; (frag_numof < MAX_FRAGMENTS) && (data < end);
+         frag_numof++) {
+        frag_desc_t *desc = &frag_desc[frag_numof];
+        uint8_t *hdr = frag_hdr[frag_numof];
+
+        if (frag_numof == 0) {
+            _init_frag1(hdr, payload_size + IPUDP_LEN);
+            memcpy(_sixlowpan_buf(hdr) + sizeof(sixlowpan_frag_t), iphc,
+                   IPHC_LEN);
+            desc->hdr_len = MHR_LEN + sizeof(sixlowpan_frag_t) + IPHC_LEN;
+        }
+        else {
+            _init_fragn(hdr, payload_size + IPUDP_LEN, offset);
+            desc->hdr_len = MHR_LEN + sizeof(sixlowpan_frag_n_t);
+        }
+        /* offsets are in the uncompressed datagram and multiples of 8 */
+        desc->data = data;
+        desc->data_len = min(((IEEE802154_MAX_FRAME_SIZE - desc->hdr_len) >> 3) << 3,
+                             end - data);
+        data += desc->data_len;
+        offset += desc->data_len;
+    }
+}
+
+static void prepare_iphc(void)
+{
+    uint8_t *ptr = iphc;
+
+    /* TF and NH elided, hop limit 64, inline addresses */
+    *(ptr++) = SIXLOWPAN_IPHC1_DISP | SIXLOWPAN_IPHC1_TF | SIXLOWPAN_IPHC1_NH |
+               0x02;
+    *(ptr++) = 0;
+    memcpy(ptr, &src, sizeof(src));
+    ptr += sizeof(src);
+    memcpy(ptr, &dst, sizeof(dst));
+    ptr += sizeof(dst);
+    memcpy(ptr, nhc_ports, sizeof(nhc_ports));
+}
+
+void exp_run(void)
+{
+    ipv6_addr_t prefix = EXP_PREFIX, next_hop;
+    unsigned lost;
+
+    /* global source, link-local sources must not be forwarded */
+    ipv6_addr_init_prefix(&src, &prefix, EXP_PREFIX_LEN);
+    dst_l2[7] = FWD_IFACE_IN;
+    ipv6_addr_set_link_local_prefix(&next_hop);
+    ipv6_addr_set_aiid(&next_hop, next_hop_l2);
+    stack_add_neighbor(FWD_IFACE_OUT, &next_hop, next_hop_l2,
+                       sizeof(next_hop_l2));
+    stack_add_route(FWD_IFACE_OUT, &dst, 128, &next_hop);
+    prepare_iphc();
+    prepare_mhrs();
+    netdev2_test_set_isr_cb(&netdevs[FWD_IFACE_IN], _netdev_isr);
+    netdev2_test_set_recv_cb(&netdevs[FWD_IFACE_IN], _netdev_recv);
+    netdev2_test_set_send_cb(&netdevs[FWD_IFACE_OUT], _netdev_send);
+#ifdef EXP_STACKTEST
+    puts("thread,stack_size,stack_free");
+#else
+    output_init(FWD_METRIC);
+#endif
+    for (payload_size = EXP_MIN_PAYLOAD; payload_size <= EXP_MAX_PAYLOAD;
+         payload_size += EXP_PAYLOAD_STEP) {
+        prepare_datagram();
+        lost = 0;
+        for (unsigned id = 0; id < EXP_RUNS; id++) {
+            uint32_t first_in = 0, last_in = 0;
+
+            _set_tag(id);
+            out_started = false;
+            for (_pos = 0; _pos < frag_numof; _pos++) {
+                last_in = timing_now();
+                if (_pos == 0) {
+                    first_in = last_in;
+                }
+                netdev->event_callback(netdev, NETDEV2_EVENT_ISR);
+#if EXP_FRAGMENT_DELAY
+                xtimer_usleep(EXP_FRAGMENT_DELAY);
+#endif
+                sema_wait(&sync);   /* wait for fragment to be received */
+            }
+            if (sema_wait_timed(&done, EXP_FWD_TIMEOUT) < 0) {
+                lost++;
+                /* a late datagram must not complete the next one */
+                sema_create(&done, 0);
+                continue;
+            }
+#if defined(EXP_STACKTEST)
+            (void)first_in;
+#elif defined(EXP_FWD_LAST)
+            (void)first_in;
+            output_record(payload_size, id, last_out - last_in);
+#else
+            output_record(payload_size, id, first_out - first_in);
+#endif
+            output_flush(false);
+#if EXP_PACKET_DELAY
+            xtimer_usleep(EXP_PACKET_DELAY);
+#endif
+        }
+        if (lost > 0) {
+            printf("# %u of %u datagrams with payload length %u not forwarded\n",
+                   lost, (unsigned)EXP_RUNS, (unsigned)payload_size);
+        }
+        output_step(payload_size);
+    }
+    output_flush(true);
+#ifdef EXP_STACKTEST
+    for (kernel_pid_t i = 0; i <= KERNEL_PID_LAST; i++) {
+        const thread_t *p = (thread_t *)sched_threads[i];
+        if ((p != NULL) &&
+            (strcmp(p->name, "idle") != 0) &&
+            (strcmp(p->name, "main") != 0)) {
+            printf("%s,%u,%u\n", p->name, p->stack_size,
+                   thread_measure_stack_free(p->stack_start));
+        }
+    }
+#endif
+}
+
+/** @} */
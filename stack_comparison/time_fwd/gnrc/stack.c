@@ -0,0 +1 @@
+../../time_tx/gnrc/stack.c
\ No newline at end of file
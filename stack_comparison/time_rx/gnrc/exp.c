@@ -14,6 +14,7 @@
  */
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -24,66 +25,118 @@
 #include "net/af.h"
 #include "net/conn/udp.h"
 #include "net/ipv6.h"
-#include "net/inet_csum.h"
 #include "net/protnum.h"
 #include "net/sixlowpan.h"
 #include "net/udp.h"
+#ifdef MODULE_RANDOM
+#include "random.h"
+#endif
 #include "thread.h"
 #include "xtimer.h"
 
+#include "csum.h"
+#include "flow.h"
 #include "netdev.h"
+#include "output.h"
+#include "probe.h"
 #include "stack.h"
+#include "timing.h"
 
 #include "exp.h"
 
 #define IEEE802154_MAX_FRAME_SIZE   (125U)
 #define MHR_LEN                     (23U)
-#if (((EXP_DST_PORT & 0xfff0) == 0xf0b0) && ((EXP_SRC_PORT & 0xfff0) == 0xf0b0))
-#define IPHC_LEN                    (6U)
-#elif ((EXP_DST_PORT & 0xff00) == 0xf000) || ((EXP_SRC_PORT & 0xff00) == 0xf000)
-#define IPHC_LEN                    (8U)
-#else
-#define IPHC_LEN                    (9U)
-#endif
+#define IPHC_LEN                    (FLOW_IPHC_LEN)
 #define IPUDP_LEN                   (sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t))
 #define MAX_FRAGMENTS               (18)
+/* the first fragment's header also carries the ID */
+#define FRAG_HDR_MAX_LEN            (MHR_LEN + sizeof(sixlowpan_frag_t) + \
+                                     IPHC_LEN + 1)
 #define TIMER_WINDOW_SIZE           (16)
 #define THREAD_PRIO                 (THREAD_PRIORITY_MAIN - 1)
-#define THREAD_STACK_SIZE           (THREAD_STACKSIZE_DEFAULT + \
-                                     THREAD_EXTRA_STACKSIZE_PRINTF)
-#define THREAD_MSG_QUEUE_SIZE       (8)
+#define THREAD_STACK_SIZE           (EXP_STACKSIZE_EXP)
+#define THREAD_MSG_QUEUE_SIZE       ((EXP_INTERLEAVE > 8) ? 16 : 8)
+
+#define SCHED_FRAG_MASK             (0x001f)
+#define SCHED_DGRAM_POS             (5U)
+#define SCHED_FIRST                 (0x8000)    /**< first fragment of datagram */
+
+#if EXP_LOSS || EXP_DUP
+#define EXP_LOSSY
+#define SCHED_SIZE                  (2 * EXP_INTERLEAVE * MAX_FRAGMENTS)
+#else
+#define SCHED_SIZE                  (EXP_INTERLEAVE * MAX_FRAGMENTS)
+#endif
+
+#if (EXP_INTERLEAVE < 1) || (EXP_INTERLEAVE > TIMER_WINDOW_SIZE)
+#error "EXP_INTERLEAVE must be between 1 and TIMER_WINDOW_SIZE"
+#endif
+
+/**
+ * @brief   Descriptor of a fragment
+ *
+ * A fragment is injected as its header followed by a slice of the
+ * uncompressed datagram in `uncomp_buffer`, so the frames never need to be
+ * assembled in between. The payloads of the interleaved datagrams only
+ * differ in their ID, so only the headers exist per datagram.
+ */
+typedef struct {
+    const uint8_t *data;    /**< slice of the datagram */
+    uint8_t hdr_len;        /**< length of the fragment's header */
+    uint8_t data_len;       /**< length of the slice */
+} frag_desc_t;
 
 static netdev2_t const *netdev = (netdev2_t *)&netdevs[0];
 static const ipv6_addr_t src = EXP_ADDR;
 static ipv6_addr_t dst;
-static const uint8_t src_l2[] = EXP_ADDR_L2;
+static const uint8_t src_l2[] = EXP_ADDR_L2;  /* XORed with datagram */
 static uint8_t dst_l2[] = NETDEV_ADDR_PREFIX;
 static uint32_t timer_window[TIMER_WINDOW_SIZE];
 static uint8_t recv_buffer[EXP_MAX_PAYLOAD];
 static uint8_t uncomp_buffer[EXP_MAX_PAYLOAD + IPUDP_LEN];
-static uint8_t frag_buf[MAX_FRAGMENTS][IEEE802154_MAX_FRAME_SIZE];
-static uint8_t frag_buf_len[MAX_FRAGMENTS];
+static uint8_t frag_hdr[EXP_INTERLEAVE][MAX_FRAGMENTS][FRAG_HDR_MAX_LEN];
+static frag_desc_t frag_desc[MAX_FRAGMENTS];
+static unsigned frag_numof;
+static uint16_t udp_csum[EXP_INTERLEAVE];   /* checksums with ID 0 */
+static uint16_t sched[EXP_INTERLEAVE * MAX_FRAGMENTS];
+static unsigned sched_numof;
+static uint16_t *inj = sched;   /* fragments actually injected */
+static unsigned inj_numof;
+static volatile uint32_t rx_mask;   /* datagrams of the round received */
+static volatile uint32_t rx_first;  /* time of first reception in round */
+#ifdef EXP_LOSSY
+static uint16_t lossy_sched[SCHED_SIZE];
+#endif
 static char thread_stack[THREAD_STACK_SIZE];
 static msg_t thread_msg_queue[THREAD_MSG_QUEUE_SIZE];
 static sema_t sync = SEMA_CREATE(0);
 
 static uint16_t payload_size;
-static uint8_t _frag = 0;
+static unsigned _pos = 0;
 static uint8_t _id = 0;
 
 static inline uint8_t *_sixlowpan_buf(uint8_t *buf);
 static inline void _init_frag1(uint8_t *buf, unsigned size, unsigned tag);
 static inline void _init_fragn(uint8_t *buf, unsigned size, unsigned tag,
                                unsigned offset);
-static inline void _init_iphc(uint8_t *buf);
-static inline void _init_ipv6(ipv6_hdr_t *buf);
-static inline void _set_chksum(uint8_t *slo_buf, const udp_hdr_t *udp_buf);
+static inline void _init_ipv6(ipv6_hdr_t *buf, unsigned dgram);
 static inline udp_hdr_t *_udp_buf(void);
-static inline void _init_udp(uint16_t src_port, uint16_t dst_port,
-                             uint16_t length);
+static inline uint16_t _init_udp(uint16_t src_port, uint16_t dst_port,
+                                 uint16_t length);
+static inline void _set_ids(uint16_t id);
+static inline unsigned _frag_len(unsigned frag);
 static void prepare_mhrs(void);
-static bool prepare_sixlowpan(void);
-static void reset_frag_buf(void);
+static void prepare_sixlowpan(void);
+static void prepare_sched(void);
+#ifdef EXP_INTERLEAVE_SHUFFLE
+static void shuffle_sched(void);
+#endif
+#ifdef EXP_LOSSY
+static void apply_loss(void);
+#endif
+#if defined(EXP_INTERLEAVE_SHUFFLE) || defined(EXP_LOSSY)
+static void mark_firsts(uint16_t *s, unsigned numof);
+#endif
 static inline int min(const int a, const int b);
 
 static void _netdev_isr(netdev2_t *dev)
@@ -95,25 +148,31 @@ static int _netdev_recv(netdev2_t *dev, char *buf, int len, void *info)
 {
     (void)dev;
     if (buf != NULL) {
-        uint8_t frag;
-        if (len < frag_buf_len[_frag]) {
+        const frag_desc_t *desc;
+        uint16_t entry = inj[_pos];
+        uint8_t frag = entry & SCHED_FRAG_MASK;
+        uint8_t dgram = (entry & ~SCHED_FIRST) >> SCHED_DGRAM_POS;
+        if (len < (int)_frag_len(frag)) {
             sema_post(&sync);   /* signal that fragment was "send" */
             return -ENOBUFS;
         }
-        frag = _frag++;
-        if (frag == 0) {
-            timer_window[_id % TIMER_WINDOW_SIZE] = xtimer_now();
+        _pos++;
+        if (entry & SCHED_FIRST) {
+            timer_window[(_id + dgram) % TIMER_WINDOW_SIZE] = timing_now();
+            probe_record(PROBE_NETDEV2);
         }
         if (info != NULL) {
             netdev2_ieee802154_rx_info_t *radio_info = info;
             radio_info->rssi = 255;
             radio_info->lqi = 35;
         }
-        memcpy(buf, frag_buf[frag], frag_buf_len[frag]);
+        desc = &frag_desc[frag];
+        memcpy(buf, frag_hdr[dgram][frag], desc->hdr_len);
+        memcpy(buf + desc->hdr_len, desc->data, desc->data_len);
         sema_post(&sync);       /* signal that fragment was send */
-        return frag_buf_len[frag];
+        return _frag_len(frag);
     }
-    return frag_buf_len[_frag];
+    return _frag_len(inj[_pos] & SCHED_FRAG_MASK);
 }
 
 void *_thread(void *arg)
@@ -133,11 +192,21 @@ void *_thread(void *arg)
         int res;
         if ((res = conn_udp_recvfrom(&conn, recv_buffer, sizeof(recv_buffer),
                                      &addr, &addr_len, &port)) > 0) {
-            uint32_t stop = xtimer_now();
+            uint32_t stop = timing_now();
             uint8_t id = recv_buffer[0];
-#ifndef EXP_STACKTEST
-            printf("%d,%" PRIu32 "\n", res,
-                   stop - timer_window[id % TIMER_WINDOW_SIZE]);
+            uint8_t dgram = id - _id;
+            probe_done();
+#ifdef EXP_PKTBUF
+            stack_pktbuf_sample();
+#endif
+            if (dgram < EXP_INTERLEAVE) {
+                if (rx_mask == 0) {
+                    rx_first = stop;
+                }
+                rx_mask |= (1UL << dgram);
+            }
+#if !defined(EXP_STACKTEST) && !defined(EXP_PROBES) && !defined(EXP_PKTBUF)
+            output_record(res, id, stop - timer_window[id % TIMER_WINDOW_SIZE]);
 #else
             (void)stop;
             (void)id;
@@ -173,89 +242,158 @@ void exp_run(void)
 #endif
 #endif
     prepare_mhrs();
-    _init_ipv6((ipv6_hdr_t *)uncomp_buffer);
+#ifdef MODULE_RANDOM
+    random_init(EXP_SEED);
+#endif
     if (thread_create(thread_stack, sizeof(thread_stack), THREAD_PRIO,
                       THREAD_CREATE_STACKTEST, _thread, NULL, "exp_receiver") < 0) {
         return;
     }
+    probe_init(PROBE_DIR_RX);
     netdev2_test_set_isr_cb(&netdevs[0], _netdev_isr);
     netdev2_test_set_recv_cb(&netdevs[0], _netdev_recv);
-#ifdef EXP_STACKTEST
+#if defined(EXP_STACKTEST)
     puts("thread,stack_size,stack_free");
+#elif defined(EXP_PROBES)
+    probe_print_header();
+#elif defined(EXP_PKTBUF)
+    puts("payload_len,runs,lost," STACK_PKTBUF_NAME "_peak");
+    (void)stack_pktbuf_peak();  /* reset after the set-up */
 #else
-    puts("payload_len,rx_traversal_time");
+    output_init("rx_traversal");
+#endif
+#ifdef EXP_LOSSY
+    puts("# lossy: payload_len,sent,received,recoveries,recover_mean_us,"
+         "recover_max_us," STACK_PKTBUF_NAME "_base," STACK_PKTBUF_NAME
+         "_peak,stale_us");
 #endif
     for (payload_size = EXP_MIN_PAYLOAD; payload_size <= EXP_MAX_PAYLOAD;
          payload_size += EXP_PAYLOAD_STEP) {
-        bool fragmented = prepare_sixlowpan();
-        for (unsigned id = 0; id < EXP_RUNS; id++) {
+        unsigned sent = 0, received = 0;
+#ifdef EXP_LOSSY
+        /* a loss starts with the first incomplete round and the stack has
+         * recovered with the first datagram of the next complete round.
+         * Recoveries can take longer than timing_now() takes to wrap around,
+         * so the starts of the rounds are summed up to `elapsed` */
+        uint32_t recoveries = 0, last_start = timing_now();
+        uint64_t elapsed = 0, lost_since = 0, recover_sum = 0, recover_max = 0;
+        bool recovering = false;
+        size_t pktbuf_base = stack_pktbuf_used(), pktbuf_peak = pktbuf_base;
+        int32_t stale_us;
+#endif
+
+        /* only tag, ID and checksum change between runs, so the datagrams and
+         * the fragments are only prepared once per payload size */
+        memset(&uncomp_buffer[IPUDP_LEN], 0, payload_size);
+        _init_ipv6((ipv6_hdr_t *)uncomp_buffer, 0);
+        udp_csum[0] = _init_udp(EXP_SRC_PORT, EXP_DST_PORT, payload_size);
+        for (unsigned i = 1; i < EXP_INTERLEAVE; i++) {
+            /* the datagrams only differ in the last byte of the source
+             * address in the pseudo-header */
+            const uint16_t word = byteorder_ntohs(src.u16[7]);
+
+            udp_csum[i] = csum_replace16(udp_csum[0], word, word ^ i);
+        }
+        prepare_sixlowpan();
+        prepare_sched();
+        for (unsigned id = 0; id < EXP_RUNS; id += EXP_INTERLEAVE) {
+#ifdef EXP_LOSSY
+            uint32_t round_start;
+#endif
             _id = id;
-            size_t offset = IPUDP_LEN;
-            unsigned fragments = 0;
-
-            memset(&uncomp_buffer[offset], id & 0xff, payload_size);
-            _init_udp(EXP_SRC_PORT, EXP_DST_PORT, payload_size);
-            if (fragmented) {
-                _set_chksum(&(frag_buf[0][frag_buf_len[0] - IPHC_LEN]),
-                            _udp_buf());
-                for (unsigned i = 0; i < MAX_FRAGMENTS; i++) {
-                    sixlowpan_frag_t *f = (sixlowpan_frag_t *)_sixlowpan_buf(frag_buf[i]);
-                    unsigned max_len;
-
-                    f->tag = byteorder_htons(id);
-                    if (offset >= (IPUDP_LEN + payload_size)) {
-                        frag_buf_len[i] = 0;
-                        continue;
-                    }
-#if defined(MODULE_LWIP)
-                    if (i == 0) {
-                        max_len = min((((IEEE802154_MAX_FRAME_SIZE - frag_buf_len[i]) >> 3) << 3) - IPHC_LEN,
-                                      IPUDP_LEN + payload_size - offset);
-                    }
-                    else {
-                        max_len = min((((IEEE802154_MAX_FRAME_SIZE - frag_buf_len[i]) >> 3) << 3),
-                                      IPUDP_LEN + payload_size - offset);
-                    }
+            probe_set_id(id);
+            _set_ids(id);
+#ifdef EXP_INTERLEAVE_SHUFFLE
+            shuffle_sched();
+#endif
+#ifdef EXP_LOSSY
+            apply_loss();
+            round_start = timing_now();
+            elapsed += round_start - last_start;
+            last_start = round_start;
 #else
-                    max_len = min(((IEEE802154_MAX_FRAME_SIZE - frag_buf_len[i]) >> 3) << 3,
-                                  IPUDP_LEN + payload_size - offset);
+            inj_numof = sched_numof;
 #endif
-                    for (unsigned j = 0; j < max_len; j++) {
-                        frag_buf[i][frag_buf_len[i]++] = uncomp_buffer[offset++];
-                    }
-                    fragments++;
-                }
-            }
-            else {
-                _set_chksum(&(frag_buf[0][frag_buf_len[0] - IPHC_LEN]),
-                            _udp_buf());
-                while (offset < (IPUDP_LEN + payload_size)) {
-                    frag_buf[0][frag_buf_len[0]++] = uncomp_buffer[offset++];
-                }
-                fragments = 1;
-            }
-            for (unsigned i = 0; i < fragments; i++) {
+            for (unsigned i = 0; i < inj_numof; i++) {
                 netdev->event_callback((netdev2_t *)netdev, NETDEV2_EVENT_ISR);
 #if EXP_FRAGMENT_DELAY
                 xtimer_usleep(EXP_FRAGMENT_DELAY);
 #endif
                 sema_wait(&sync);   /* wait for fragment to be processed by
                                      * netdev2 */
+#ifdef EXP_PKTBUF
+                /* partial reassemblies are held between the fragments */
+                stack_pktbuf_sample();
+#endif
             }
 #if EXP_PACKET_DELAY
             xtimer_usleep(EXP_PACKET_DELAY);
 #endif
-            reset_frag_buf();
-            _frag = 0;
+            probe_flush(payload_size);
+            output_flush(false);
+            _pos = 0;
+            sent += EXP_INTERLEAVE;
+            received += __builtin_popcount(rx_mask);
+#ifdef EXP_LOSSY
+            if (rx_mask == ((1UL << EXP_INTERLEAVE) - 1)) {
+                if (recovering) {
+                    uint64_t recover = elapsed - lost_since +
+                                       (uint32_t)(rx_first - round_start);
+
+                    recoveries++;
+                    recover_sum += recover;
+                    if (recover > recover_max) {
+                        recover_max = recover;
+                    }
+                    recovering = false;
+                }
+            }
+            else if (!recovering) {
+                lost_since = elapsed;
+                recovering = true;
+            }
+            size_t used = stack_pktbuf_used();
+            if (used > pktbuf_peak) {
+                pktbuf_peak = used;
+            }
+#endif
+            rx_mask = 0;
+        }
+        if (received < sent) {
+            printf("# %u of %u datagrams with payload length %u not received\n",
+                   sent - received, sent, (unsigned)payload_size);
         }
+#ifdef EXP_PKTBUF
+        printf("%u,%u,%u,%u\n", (unsigned)payload_size, sent, sent - received,
+               (unsigned)stack_pktbuf_peak());
+#endif
+#ifdef EXP_LOSSY
+        /* wait for the stack to release what incomplete reassemblies hold */
+        stale_us = 0;
+        while (stack_pktbuf_used() > pktbuf_base) {
+            if (stale_us >= EXP_STALE_MAX) {
+                stale_us = -1;
+                break;
+            }
+            xtimer_usleep(EXP_STALE_POLL);
+            stale_us += EXP_STALE_POLL;
+        }
+        printf("# lossy: %u,%u,%u,%" PRIu32 ",%" PRIu64 ",%" PRIu64 ",%u,%u,%"
+               PRId32 "\n", (unsigned)payload_size, sent, received, recoveries,
+               (recoveries > 0) ?
+               timing_ticks_to_ns(recover_sum / recoveries) / 1000 : 0,
+               timing_ticks_to_ns(recover_max) / 1000, (unsigned)pktbuf_base,
+               (unsigned)pktbuf_peak, stale_us);
+#endif
+        output_step(payload_size);
     }
+    output_flush(true);
 #ifdef EXP_STACKTEST
     for (kernel_pid_t i = 0; i <= KERNEL_PID_LAST; i++) {
         const thread_t *p = (thread_t *)sched_threads[i];
         if ((p != NULL) &&
             (strcmp(p->name, "idle") != 0) &&
-            (strcmp(p->name, "main") != 0) &&
-            (strcmp(p->name, "exp_receiver") != 0)) {
+            (strcmp(p->name, "main") != 0)) {
             printf("%s,%u,%u\n", p->name, p->stack_size,
                    thread_measure_stack_free(p->stack_start));
         }
@@ -293,45 +431,10 @@ static inline void _init_fragn(uint8_t *buf, unsigned size, unsigned tag,
     fragn->offset = offset >> 3;
 }
 
-static inline void _init_iphc(uint8_t *buf)
-{
-    buf[0] = SIXLOWPAN_IPHC1_DISP;
-    buf[0] |= SIXLOWPAN_IPHC1_TF | SIXLOWPAN_IPHC1_NH;
-    buf[0] |= 0x02;     /* Hop-limit: 64 */
-    buf[1] = 0;
-    buf[1] |= SIXLOWPAN_IPHC2_SAM;
-    buf[1] |= SIXLOWPAN_IPHC2_DAM;
-    buf[2] = 0xf0;      /* UDP LOWPAN_NHC ID */
-#if (((EXP_DST_PORT & 0xfff0) == 0xf0b0) && ((EXP_SRC_PORT & 0xfff0) == 0xf0b0))
-    buf[2] |= 0x03;
-    buf[3] = (((EXP_SRC_PORT) & 0xf) << 4) | ((EXP_DST_PORT) & 0xf);
-#elif ((EXP_DST_PORT & 0xff00) == 0xf000)
-    buf[2] |= 0x01;
-    buf[3] = (EXP_SRC_PORT >> 8);
-    buf[4] = (EXP_SRC_PORT & 0xff);
-    buf[5] = (EXP_DST_PORT & 0xff);
-#elif ((EXP_SRC_PORT & 0xff00) == 0xf000)
-    buf[2] |= 0x02;
-    buf[3] = (EXP_SRC_PORT & 0xff);
-    buf[4] = (EXP_DST_PORT >> 8);
-    buf[5] = (EXP_DST_PORT & 0xff);
-#else
-    buf[3] = (EXP_SRC_PORT >> 8);
-    buf[4] = (EXP_SRC_PORT & 0xff);
-    buf[5] = (EXP_DST_PORT >> 8);
-    buf[6] = (EXP_DST_PORT & 0xff);
-#endif
-}
-
-static inline void _set_chksum(uint8_t *slo_buf, const udp_hdr_t *udp_buf)
-{
-    slo_buf[IPHC_LEN - 2] = udp_buf->checksum.u8[0];
-    slo_buf[IPHC_LEN - 1] = udp_buf->checksum.u8[1];
-}
-
-static inline void _init_ipv6(ipv6_hdr_t *buf)
+static inline void _init_ipv6(ipv6_hdr_t *buf, unsigned dgram)
 {
     memcpy(&buf->src, &src, sizeof(src));
+    buf->src.u8[15] ^= dgram;
     memcpy(&buf->dst, &dst, sizeof(dst));
 }
 
@@ -340,8 +443,8 @@ static inline udp_hdr_t *_udp_buf(void)
     return (udp_hdr_t *)(&uncomp_buffer[sizeof(ipv6_hdr_t)]);
 }
 
-static inline void _init_udp(uint16_t src_port, uint16_t dst_port,
-                             uint16_t length)
+static inline uint16_t _init_udp(uint16_t src_port, uint16_t dst_port,
+                                 uint16_t length)
 {
     udp_hdr_t *buf = _udp_buf();
     uint16_t chksum = 0;
@@ -351,79 +454,194 @@ static inline void _init_udp(uint16_t src_port, uint16_t dst_port,
     buf->dst_port = byteorder_htons(dst_port);
     buf->checksum.u16 = 0;
     buf->length = byteorder_htons(length);
-    chksum = inet_csum(chksum, (uint8_t *)buf, length);
-    chksum = ipv6_hdr_inet_csum(chksum,
-                                (ipv6_hdr_t *)(((uint8_t *)buf) - sizeof(ipv6_hdr_t)),
-                                PROTNUM_UDP, length);
-    if (chksum == 0) {
-        chksum = 0xffff;
+    chksum = csum_inet(chksum, (uint8_t *)buf, length);
+    return ipv6_hdr_inet_csum(chksum,
+                              (ipv6_hdr_t *)(((uint8_t *)buf) - sizeof(ipv6_hdr_t)),
+                              PROTNUM_UDP, length);
+}
+
+static inline void _set_ids(uint16_t id)
+{
+    udp_hdr_t *udp = _udp_buf();
+    const unsigned id_pos = frag_desc[0].hdr_len - 1;
+
+    for (unsigned i = 0; i < EXP_INTERLEAVE; i++) {
+        /* the tag only repeats every 2^16 datagrams, the ID in the payload
+         * every 256 */
+        uint16_t tag = id + i;
+        uint8_t dgram_id = tag & 0xff;
+        /* the ID is the upper byte of the first 16-bit word of the payload,
+         * which is 0 in the precomputed sum */
+        uint16_t chksum = ~csum_replace16(udp_csum[i], 0, dgram_id << 8);
+
+        frag_hdr[i][0][id_pos] = dgram_id;
+        if (chksum == 0) {
+            chksum = 0xffff;
+        }
+        udp->checksum = byteorder_htons(chksum);
+        flow_iphc_write(&frag_hdr[i][0][id_pos - IPHC_LEN], udp->checksum);
+        if (frag_numof > 1) {
+            for (unsigned j = 0; j < frag_numof; j++) {
+                sixlowpan_frag_t *f = (sixlowpan_frag_t *)_sixlowpan_buf(frag_hdr[i][j]);
+
+                f->tag = byteorder_htons(tag);
+            }
+        }
     }
-    buf->checksum = byteorder_htons(~chksum);
+}
+
+static inline unsigned _frag_len(unsigned frag)
+{
+    return frag_desc[frag].hdr_len + frag_desc[frag].data_len;
 }
 
 static void prepare_mhrs(void)
 {
-    for (unsigned i = 0; i < MAX_FRAGMENTS; i++) {
-        const le_uint16_t pan_id = byteorder_btols(byteorder_htons(NETDEV_PAN_ID));
-        ieee802154_set_frame_hdr(frag_buf[i], src_l2, sizeof(src_l2),
-                                 dst_l2, sizeof(dst_l2), pan_id, pan_id,
-                                 IEEE802154_FCF_TYPE_DATA | IEEE802154_FCF_ACK_REQ,
-                                 i);
+    for (unsigned dgram = 0; dgram < EXP_INTERLEAVE; dgram++) {
+        uint8_t l2[sizeof(src_l2)];
+
+        memcpy(l2, src_l2, sizeof(l2));
+        l2[sizeof(l2) - 1] ^= dgram;
+        for (unsigned i = 0; i < MAX_FRAGMENTS; i++) {
+            const le_uint16_t pan_id = byteorder_btols(byteorder_htons(NETDEV_PAN_ID));
+            ieee802154_set_frame_hdr(frag_hdr[dgram][i], l2, sizeof(l2),
+                                     dst_l2, sizeof(dst_l2), pan_id, pan_id,
+                                     IEEE802154_FCF_TYPE_DATA | IEEE802154_FCF_ACK_REQ,
+                                     i);
+        }
     }
 }
 
-static bool prepare_sixlowpan(void)
+static void prepare_sixlowpan(void)
 {
+    const uint8_t *data = &uncomp_buffer[IPUDP_LEN];
+    const uint8_t *end = data + payload_size;
+
     if (payload_size > (IEEE802154_MAX_FRAME_SIZE - MHR_LEN - IPHC_LEN)) {
+        for (unsigned dgram = 0; dgram < EXP_INTERLEAVE; dgram++) {
 #if defined(MODULE_LWIP)    /* lwIP uses datagram size *after* compression */
-        int fragn_offset = ((IEEE802154_MAX_FRAME_SIZE - MHR_LEN -
-                             sizeof(sixlowpan_frag_t) - IPHC_LEN) >> 3) << 3;
+            int fragn_offset = ((IEEE802154_MAX_FRAME_SIZE - MHR_LEN -
+                                 sizeof(sixlowpan_frag_t) - IPHC_LEN) >> 3) << 3;
 #else
-        int fragn_offset = ((IEEE802154_MAX_FRAME_SIZE - MHR_LEN -
-                             sizeof(sixlowpan_frag_t) - IPHC_LEN +
-                             sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t)) >> 3) << 3;
+            int fragn_offset = ((IEEE802154_MAX_FRAME_SIZE - MHR_LEN -
+                                 sizeof(sixlowpan_frag_t) - IPHC_LEN +
+                                 sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t)) >> 3) << 3;
 #endif
-        _init_iphc(_sixlowpan_buf(frag_buf[0]) + sizeof(sixlowpan_frag_t));
+            uint8_t (*hdr)[FRAG_HDR_MAX_LEN] = frag_hdr[dgram];
+
+            memcpy(_sixlowpan_buf(hdr[0]) + sizeof(sixlowpan_frag_t), flow_iphc,
+                   IPHC_LEN);
 #if defined(MODULE_LWIP)    /* lwIP uses datagram size *after* compression */
-        _init_frag1(frag_buf[0], payload_size + IPHC_LEN, 0);
+            _init_frag1(hdr[0], payload_size + IPHC_LEN, 0);
 #else
-        _init_frag1(frag_buf[0], payload_size + IPUDP_LEN, 0);
+            _init_frag1(hdr[0], payload_size + IPUDP_LEN, 0);
 #endif
-        frag_buf_len[0] = MHR_LEN + sizeof(sixlowpan_frag_t) + IPHC_LEN;
-        for (unsigned frag = 1; frag < MAX_FRAGMENTS; frag++) {
+            for (unsigned frag = 1; frag < MAX_FRAGMENTS; frag++) {
 #if defined(MODULE_LWIP)    /* lwIP uses datagram size *after* compression */
-            _init_fragn(frag_buf[frag], payload_size + IPHC_LEN, 0,
-                        fragn_offset);
+                _init_fragn(hdr[frag], payload_size + IPHC_LEN, 0,
+                            fragn_offset);
 #else
-            _init_fragn(frag_buf[frag], payload_size + IPUDP_LEN, 0,
-                        fragn_offset);
+                _init_fragn(hdr[frag], payload_size + IPUDP_LEN, 0,
+                            fragn_offset);
 #endif
-            _init_iphc(_sixlowpan_buf(frag_buf[frag]) + sizeof(sixlowpan_frag_n_t));
-            fragn_offset += ((IEEE802154_MAX_FRAME_SIZE - MHR_LEN -
-                             sizeof(sixlowpan_frag_n_t)) >> 3) << 3;
-            frag_buf_len[frag] = MHR_LEN + sizeof(sixlowpan_frag_n_t);
+                fragn_offset += ((IEEE802154_MAX_FRAME_SIZE - MHR_LEN -
+                                 sizeof(sixlowpan_frag_n_t)) >> 3) << 3;
+            }
+        }
+        frag_desc[0].hdr_len = MHR_LEN + sizeof(sixlowpan_frag_t) + IPHC_LEN;
+        for (unsigned frag = 1; frag < MAX_FRAGMENTS; frag++) {
+            frag_desc[frag].hdr_len = MHR_LEN + sizeof(sixlowpan_frag_n_t);
+        }
+        for (frag_numof = 0; (frag_numof < MAX_FRAGMENTS) && (data < end);
+             frag_numof++) {
+            frag_desc_t *desc = &frag_desc[frag_numof];
+            unsigned max_len = ((IEEE802154_MAX_FRAME_SIZE - desc->hdr_len) >> 3) << 3;
+
+#if defined(MODULE_LWIP)
+            if (frag_numof == 0) {
+                max_len -= IPHC_LEN;
+            }
+#endif
+            desc->data = data;
+            desc->data_len = min(max_len, end - data);
+            data += desc->data_len;
         }
-        return true;
     }
     else {
-        _init_iphc(_sixlowpan_buf(frag_buf[0]));
-        frag_buf_len[0] = MHR_LEN + IPHC_LEN;
-        return false;
+        for (unsigned dgram = 0; dgram < EXP_INTERLEAVE; dgram++) {
+            memcpy(_sixlowpan_buf(frag_hdr[dgram][0]), flow_iphc, IPHC_LEN);
+        }
+        frag_desc[0].hdr_len = MHR_LEN + IPHC_LEN;
+        frag_desc[0].data = data;
+        frag_desc[0].data_len = payload_size;
+        frag_numof = 1;
     }
+    /* move the ID (first byte of the payload) into the header */
+    frag_desc[0].hdr_len++;
+    frag_desc[0].data++;
+    frag_desc[0].data_len--;
 }
 
-static void reset_frag_buf(void)
+static void prepare_sched(void)
 {
-    if (payload_size > (IEEE802154_MAX_FRAME_SIZE - MHR_LEN - IPHC_LEN)) {
-        frag_buf_len[0] = MHR_LEN + IPHC_LEN + sizeof(sixlowpan_frag_t);
-        for (unsigned frag = 1; frag < MAX_FRAGMENTS; frag++) {
-            frag_buf_len[frag] = MHR_LEN + sizeof(sixlowpan_frag_n_t);
+    sched_numof = 0;
+    for (unsigned frag = 0; frag < frag_numof; frag++) {
+        for (unsigned dgram = 0; dgram < EXP_INTERLEAVE; dgram++) {
+            sched[sched_numof++] = (dgram << SCHED_DGRAM_POS) | frag |
+                                   ((frag == 0) ? SCHED_FIRST : 0);
         }
     }
-    else {
-        frag_buf_len[0] = MHR_LEN + IPHC_LEN;
+}
+
+#ifdef EXP_INTERLEAVE_SHUFFLE
+static void shuffle_sched(void)
+{
+    for (unsigned i = sched_numof - 1; i > 0; i--) {
+        unsigned j = random_uint32() % (i + 1);
+        uint16_t tmp = sched[i];
+
+        sched[i] = sched[j];
+        sched[j] = tmp;
     }
+    mark_firsts(sched, sched_numof);
 }
+#endif
+
+#ifdef EXP_LOSSY
+static void apply_loss(void)
+{
+    inj = lossy_sched;
+    inj_numof = 0;
+    for (unsigned i = 0; i < sched_numof; i++) {
+        if ((random_uint32() % 1000) < EXP_LOSS) {
+            continue;
+        }
+        lossy_sched[inj_numof++] = sched[i];
+        if ((random_uint32() % 1000) < EXP_DUP) {
+            lossy_sched[inj_numof++] = sched[i];
+        }
+    }
+    mark_firsts(lossy_sched, inj_numof);
+}
+#endif
+
+#if defined(EXP_INTERLEAVE_SHUFFLE) || defined(EXP_LOSSY)
+static void mark_firsts(uint16_t *s, unsigned numof)
+{
+    uint32_t seen = 0;
+
+    /* the timer starts with whatever fragment of a datagram comes first */
+    for (unsigned i = 0; i < numof; i++) {
+        unsigned dgram = (s[i] & ~SCHED_FIRST) >> SCHED_DGRAM_POS;
+
+        s[i] &= ~SCHED_FIRST;
+        if (!(seen & (1UL << dgram))) {
+            s[i] |= SCHED_FIRST;
+            seen |= (1UL << dgram);
+        }
+    }
+}
+#endif
 
 static inline int min(const int a, const int b)
 {
@@ -0,0 +1 @@
+../../time_tx/gnrc/probe.h
\ No newline at end of file
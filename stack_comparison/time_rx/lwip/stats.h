@@ -0,0 +1 @@
+../../time_tx/gnrc/stats.h
\ No newline at end of file
@@ -0,0 +1 @@
+../gnrc/csum.c
\ No newline at end of file
@@ -0,0 +1 @@
+../gnrc/csum.h
\ No newline at end of file
@@ -0,0 +1 @@
+../gnrc/output.h
\ No newline at end of file
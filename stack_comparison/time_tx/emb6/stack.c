@@ -18,28 +18,157 @@
 
 #include "emb6.h"
 #include "emb6/netdev2.h"
+#ifdef EXP_EMB6_EVENT
+#include "etimer.h"
+#include "evproc.h"
+#include "irq.h"
+#include "msg.h"
+#include "xtimer.h"
+#endif
 #ifdef STACK_RPL
 #include "rpl.h"
 #endif
 #include "uip-ds6.h"
+#ifdef EXP_PROBES
+#include "uip-udp-packet.h"
+#include "tcpip.h"
+#endif
 #include "net/ipv6/addr.h"
 #include "thread.h"
 
+#include "exp.h"
+#ifdef EXP_LPM
+#include "lpm.h"
+#endif
 #include "netdev.h"
+#include "probe.h"
 
 #include "stack.h"
 
-#define EMB6_STACKSIZE  (THREAD_STACKSIZE_DEFAULT)
+#define EMB6_STACKSIZE  (EXP_STACKSIZE_EMB6)
 #define EMB6_PRIO       (THREAD_PRIORITY_MAIN - 3)
 #define EMB6_DELAY      (58)
 
 static s_ns_t emb6;
 static char emb6_stack[EMB6_STACKSIZE];
+static size_t _pktbuf_peak;
+
+#ifdef EXP_EMB6_EVENT
+#define EMB6_QUEUE_SIZE     (8)
+#define EMB6_MSG_TYPE_EVENT (0x4536)
+
+static msg_t emb6_queue[EMB6_QUEUE_SIZE];
+static kernel_pid_t emb6_pid = KERNEL_PID_UNDEF;
+
+en_evprocResCode_t __real_evproc_putEvent(en_evprocAction_t e_actType,
+                                          c_event_t c_eventType,
+                                          p_data_t p_data);
+
+/* linked in place of evproc_putEvent() with EMB6_EVENT=1 (see
+ * time_tx/Makefile.common): events put from outside of the emb6 thread, e.g.
+ * by the netdev2 event callback, wake it up */
+en_evprocResCode_t __wrap_evproc_putEvent(en_evprocAction_t e_actType,
+                                          c_event_t c_eventType,
+                                          p_data_t p_data)
+{
+    en_evprocResCode_t res = __real_evproc_putEvent(e_actType, c_eventType,
+                                                    p_data);
+
+    if ((emb6_pid != KERNEL_PID_UNDEF) &&
+        (inISR() || (thread_getpid() != emb6_pid))) {
+        msg_t msg;
+
+        /* if the queue is full the thread is woken up anyway */
+        msg.type = EMB6_MSG_TYPE_EVENT;
+        msg_try_send(&msg, emb6_pid);
+    }
+    return res;
+}
+#endif
+
+#ifdef EXP_PROBES
+typedef uint8_t (*_output_t)(const uip_lladdr_t *);
+
+static _output_t _sicslowpan_output;
+
+void __real_uip_udp_packet_sendto(struct uip_udp_conn *c, const void *data,
+                                  int len, const uip_ipaddr_t *toaddr,
+                                  uint16_t toport);
+void __real_tcpip_ipv6_output(void);
+void __real_tcpip_input(void);
+void __real_tcpip_set_outputfunc(_output_t f);
+
+/* the probes are linked in front of the layers' entry points with PROBES=1
+ * (see time_tx/Makefile.common) */
+void __wrap_uip_udp_packet_sendto(struct uip_udp_conn *c, const void *data,
+                                  int len, const uip_ipaddr_t *toaddr,
+                                  uint16_t toport)
+{
+    probe_record(PROBE_UDP);
+    __real_uip_udp_packet_sendto(c, data, len, toaddr, toport);
+}
+
+void __wrap_tcpip_ipv6_output(void)
+{
+    probe_record(PROBE_IPV6);
+    __real_tcpip_ipv6_output();
+}
+
+void __wrap_tcpip_input(void)
+{
+    probe_record(PROBE_IPV6);
+    __real_tcpip_input();
+}
+
+/* sicslowpan's output function is static, so it is probed through the
+ * pointer it hands to tcpip */
+static uint8_t _probe_sicslowpan_output(const uip_lladdr_t *localdest)
+{
+    probe_record(PROBE_SIXLOWPAN);
+    return _sicslowpan_output(localdest);
+}
+
+void __wrap_tcpip_set_outputfunc(_output_t f)
+{
+    _sicslowpan_output = f;
+    __real_tcpip_set_outputfunc(_probe_sicslowpan_output);
+}
+#endif
 
 static void *_emb6_thread(void *args)
 {
     (void)args;
+#ifdef EXP_EMB6_EVENT
+    /* the loop of emb6_process(), but instead of sleeping EMB6_DELAY after
+     * every round the thread blocks until an event is put or the next timer
+     * expires */
+    msg_init_queue(emb6_queue, EMB6_QUEUE_SIZE);
+    emb6_pid = thread_getpid();
+    while (1) {
+        msg_t msg;
+
+        /* expired timers put their events as well */
+        etimer_request_poll();
+        while (evproc_nextEvent() != 0) {}
+        if (etimer_pending()) {
+            int32_t ticks = etimer_next_expiration_time() - clock_time();
+
+            if (ticks > 0) {
+                uint64_t timeout = ((uint64_t)ticks * 1000000U) / CLOCK_SECOND;
+
+                /* waking up too early only checks the timers once more */
+                xtimer_msg_receive_timeout(&msg, (timeout > UINT32_MAX) ?
+                                                 UINT32_MAX : timeout);
+            }
+        }
+        else {
+            /* timers set in the meantime put a poll request */
+            msg_receive(&msg);
+        }
+    }
+#else
     emb6_process(EMB6_DELAY);   /* never stops */
+#endif
     return NULL;
 }
 
@@ -71,7 +200,46 @@ void stack_add_neighbor(int iface, const ipv6_addr_t *ipv6_addr,
                     (const uip_lladdr_t *)l2_addr, 0, NBR_REACHABLE);
 }
 
+size_t stack_pktbuf_used(void)
+{
+    /* emb6 reassembles into its static uip_buf and allocates nothing, so this
+     * is the datagram in there (see STACK_PKTBUF_NAME) */
+    return uip_len;
+}
+
+void stack_pktbuf_sample(void)
+{
+    /* the datagram in uip_buf is what UIP_CONF_BUFFER_SIZE has to hold */
+    if (uip_len > _pktbuf_peak) {
+        _pktbuf_peak = uip_len;
+    }
+}
+
+size_t stack_pktbuf_peak(void)
+{
+    size_t peak = _pktbuf_peak;
+
+    _pktbuf_peak = 0;
+    return peak;
+}
+
 #ifdef STACK_MULTIHOP
+#ifdef EXP_LPM
+#ifdef STACK_RPL
+#error "routes of RPL are not indexed, so EXP_LPM would shadow them"
+#endif
+
+uip_ds6_route_t *__real_uip_ds6_route_lookup(uip_ipaddr_t *addr);
+
+/* linked in place of uip_ds6_route_lookup() with LPM=1 (see time_tx_fib/emb6) */
+uip_ds6_route_t *__wrap_uip_ds6_route_lookup(uip_ipaddr_t *addr)
+{
+    uip_ds6_route_t *res = lpm_lookup((ipv6_addr_t *)addr);
+
+    return (res != NULL) ? res : __real_uip_ds6_route_lookup(addr);
+}
+#endif
+
 const ipv6_addr_t *stack_add_prefix(int iface, const ipv6_addr_t *prefix,
                                     uint8_t prefix_len)
 {
@@ -96,8 +264,19 @@ void stack_add_route(int iface, const ipv6_addr_t *prefix, uint8_t prefix_len,
                             (uip_ipaddr_t *)next_hop);
     if (res != NULL) {
         res->state.lifetime = UINT32_MAX;
+#ifdef EXP_LPM
+        /* the route never expires, so the index can point to it */
+        lpm_add(prefix, prefix_len, res);
+#endif
     }
 }
+
+bool stack_has_route(const ipv6_addr_t *dst)
+{
+    /* RPL installs the route to its preferred parent as default route */
+    return (uip_ds6_route_lookup((uip_ipaddr_t *)dst) != NULL) ||
+           (uip_ds6_defrt_choose() != NULL);
+}
 #endif
 
 #ifdef STACK_RPL
@@ -0,0 +1 @@
+../gnrc/stats.c
\ No newline at end of file
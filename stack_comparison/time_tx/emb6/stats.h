@@ -0,0 +1 @@
+../gnrc/stats.h
\ No newline at end of file
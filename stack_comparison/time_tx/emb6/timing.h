@@ -0,0 +1 @@
+../gnrc/timing.h
\ No newline at end of file
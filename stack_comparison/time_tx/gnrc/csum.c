@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <string.h>
+
+#include "byteorder.h"
+#ifdef EXP_FAST_CSUM
+#include "net/inet_csum.h"
+#endif
+
+#include "csum.h"
+
+static inline uint32_t _load32(const uint8_t *buf)
+{
+    uint32_t word;
+
+    memcpy(&word, buf, sizeof(word));
+    return word;
+}
+
+uint16_t csum_inet(uint16_t sum, const uint8_t *buf, size_t len)
+{
+    /* the one's complement sum is byte order independent (RFC 1071), so the
+     * words are summed up in host byte order and only the result is swapped */
+    uint64_t acc = 0;
+    network_uint16_t res;
+
+    while (len >= 16) {
+        acc += _load32(buf);
+        acc += _load32(buf + 4);
+        acc += _load32(buf + 8);
+        acc += _load32(buf + 12);
+        buf += 16;
+        len -= 16;
+    }
+    while (len >= 4) {
+        acc += _load32(buf);
+        buf += 4;
+        len -= 4;
+    }
+    if (len > 0) {
+        /* pad to a full word with zeroes */
+        uint8_t tail[4] = { 0 };
+
+        memcpy(tail, buf, len);
+        acc += _load32(tail);
+    }
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    res.u16 = csum_fold((uint32_t)acc);
+    return csum_fold((uint32_t)sum + byteorder_ntohs(res));
+}
+
+#ifdef EXP_FAST_CSUM
+/* replaces the byte-wise implementation of the inet_csum module */
+uint16_t inet_csum_slice(uint16_t sum, const uint8_t *buf, uint16_t len,
+                         size_t accum_len)
+{
+    if ((accum_len & 1) && (len > 0)) {
+        /* buf continues a word of the previous slice */
+        sum = csum_fold((uint32_t)sum + *(buf++));
+        len--;
+    }
+    return csum_inet(sum, buf, len);
+}
+#endif
+
+/** @} */
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Internet checksum helpers
+ *
+ * Sums are the un-complemented 16-bit one's complement sums in host byte
+ * order as returned by `inet_csum()`. @ref csum_inet() computes the same sum
+ * 32 bits at a time, @ref csum_replace16() updates a sum for a changed 16-bit
+ * word in constant time (RFC 1624, eqn. 3).
+ *
+ * With `EXP_FAST_CSUM` (`FAST_CSUM=1` on the make command line) @ref
+ * csum_inet() also replaces the implementation of RIOT's `inet_csum` module,
+ * so gnrc and the generators use it for all checksums.
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef CSUM_H_
+#define CSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Folds a 32-bit one's complement sum to 16 bits
+ */
+static inline uint16_t csum_fold(uint32_t sum)
+{
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (sum & 0xffff) + (sum >> 16);
+}
+
+/**
+ * @brief   Updates @p sum for a 16-bit word changing from @p old to @p new
+ *
+ * @param[in] sum   Sum over the data with @p old.
+ * @param[in] old   Old value of the word (host byte order).
+ * @param[in] new   New value of the word (host byte order).
+ *
+ * @return  Sum over the data with @p new.
+ */
+static inline uint16_t csum_replace16(uint16_t sum, uint16_t old, uint16_t new)
+{
+    return csum_fold((uint32_t)sum + (uint16_t)~old + new);
+}
+
+/**
+ * @brief   Adds the 16-bit big-endian words of @p buf to @p sum
+ *
+ * Drop-in for `inet_csum()` that reads 4 words per loop iteration. @p buf
+ * does not need to be aligned.
+ *
+ * @param[in] sum   Initial sum.
+ * @param[in] buf   Data to sum up.
+ * @param[in] len   Length of @p buf.
+ *
+ * @return  The sum.
+ */
+uint16_t csum_inet(uint16_t sum, const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CSUM_H_ */
+/** @} */
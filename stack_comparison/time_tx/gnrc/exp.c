@@ -13,17 +13,28 @@
  * @author Martine Lenders <mlenders@inf.fu-berlin.de>
  */
 
+#include <errno.h>
 #include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
 
+#include "byteorder.h"
 #include "net/af.h"
 #include "net/conn/udp.h"
 #include "net/ipv6/addr.h"
 #include "net/netdev2_test.h"
+#ifdef MODULE_RANDOM
+#include "random.h"
+#endif
+#include "sema.h"
 #include "thread.h"
 #include "xtimer.h"
 
 #include "netdev.h"
+#include "output.h"
+#include "probe.h"
 #include "stack.h"
+#include "timing.h"
 
 #include "exp.h"
 
@@ -40,10 +51,29 @@ static uint8_t payload_buffer[EXP_MAX_PAYLOAD];
 static uint32_t timer_window[TIMER_WINDOW_SIZE];
 static uint16_t payload_size;
 
+#ifdef EXP_SATURATION
+#define THREAD_PRIO         (EXP_SATURATION_PRIO)
+#define THREAD_STACK_SIZE   (EXP_STACKSIZE_EXP)
+
+static char thread_stack[THREAD_STACK_SIZE];
+static sema_t sync = SEMA_CREATE(0);
+static volatile uint32_t completed;
+static volatile uint32_t last_completion;
+/* summed up per completion, since a run can take longer than timing_now()
+ * takes to wrap around */
+static volatile uint64_t duration;
+#endif
+#ifdef EXP_PKTBUF
+static volatile unsigned delivered;
+#endif
+#ifdef EXP_NC
+static unsigned neighbors;
+#endif
+
 static int _netdev2_send(netdev2_t *dev, const struct iovec *vector, int count)
 {
     /* first things first */
-    const uint32_t stop = xtimer_now();
+    const uint32_t stop = timing_now();
     const uint8_t *payload = vector[count - 1].iov_base;
     const size_t payload_len = vector[count - 1].iov_len;
     const uint8_t *_hg = &payload[payload_len - HONEYGUIDE_LEN];
@@ -53,9 +83,15 @@ static int _netdev2_send(netdev2_t *dev, const struct iovec *vector, int count)
     uint8_t id;
 
     (void)dev;
+    probe_record(PROBE_NETDEV2);
     for (int i = 0; i < count; i++) {
         res += vector[i].iov_len;
     }
+    probe_done();
+#ifdef EXP_PKTBUF
+    /* the stack still holds the datagram while it sends the fragments */
+    stack_pktbuf_sample();
+#endif
 
     /* filter out unwanted packets */
     if (payload_len < TAIL_LEN) {
@@ -72,8 +108,19 @@ static int _netdev2_send(netdev2_t *dev, const struct iovec *vector, int count)
     }
 
     start = timer_window[id % TIMER_WINDOW_SIZE];
-#ifndef EXP_STACKTEST
-    printf("%u,%" PRIu32 "\n", (unsigned)exp_payload_len, (stop - start));
+#if defined(EXP_SATURATION)
+    (void)start;
+    (void)exp_payload_len;
+    duration += stop - last_completion;
+    last_completion = stop;
+    completed++;
+#elif defined(EXP_PKTBUF)
+    (void)stop;
+    (void)start;
+    (void)exp_payload_len;
+    delivered++;
+#elif !defined(EXP_STACKTEST) && !defined(EXP_PROBES)
+    output_record(exp_payload_len, id, stop - start);
 #else
     (void)stop;
     (void)start;
@@ -81,15 +128,205 @@ static int _netdev2_send(netdev2_t *dev, const struct iovec *vector, int count)
     return res;
 }
 
-void exp_run(void)
+#ifdef EXP_FIB
+#if EXP_PREFIX_LEN > 16
+#error "EXP_FIB needs the 16 bits after EXP_PREFIX to number the routes"
+#endif
+
+/* grows the FIB to the next size with routes of mixed prefix lengths below
+ * EXP_PREFIX, none of them covers dst, so the lookup has to check all of them
+ * before it falls back to the default route. Returns the new size or 0 when
+ * EXP_FIB_MAX was reached. */
+static unsigned _fib_grow(unsigned routes, const ipv6_addr_t *next_hop)
+{
+    static const uint8_t prefix_lens[] = { 32, 48, 64, 96, 128 };
+    unsigned size;
+
+    if (routes >= EXP_FIB_MAX) {
+        return 0;
+    }
+    size = (routes < EXP_FIB_MIN) ? EXP_FIB_MIN :
+           ((routes / EXP_FIB_STEP) + 1) * EXP_FIB_STEP;
+    if (size > EXP_FIB_MAX) {
+        size = EXP_FIB_MAX;
+    }
+    for (; routes < size; routes++) {
+        ipv6_addr_t prefix = EXP_PREFIX;
+        uint8_t prefix_len = prefix_lens[routes % sizeof(prefix_lens)];
+
+        prefix.u16[1] = byteorder_htons(routes + 1);
+        for (unsigned i = 4; i < (prefix_len / 8U); i++) {
+            prefix.u8[i] = (routes * 37U) + i;
+        }
+        stack_add_route(0, &prefix, prefix_len, next_hop);
+    }
+    return size;
+}
+#endif
+
+#ifdef EXP_NC
+#ifdef STACK_MULTIHOP
+#error "EXP_NC needs the neighbors to be the destinations"
+#endif
+
+/* neighbor @p idx has EXP_ADDR and EXP_ADDR_L2 with @p idx XORed into their
+ * last two bytes, so neighbor 0 is the destination of the other experiments */
+static void _nc_neighbor(unsigned idx, ipv6_addr_t *addr, uint8_t *l2_addr)
+{
+    const ipv6_addr_t exp_addr = EXP_ADDR;
+
+    memcpy(addr, &exp_addr, sizeof(exp_addr));
+    addr->u8[14] ^= (idx >> 8) & 0xff;
+    addr->u8[15] ^= idx & 0xff;
+    if (l2_addr != NULL) {
+        memcpy(l2_addr, dst_l2, sizeof(dst_l2));
+        l2_addr[sizeof(dst_l2) - 2] ^= (idx >> 8) & 0xff;
+        l2_addr[sizeof(dst_l2) - 1] ^= idx & 0xff;
+    }
+}
+
+/* grows the neighbor cache to the next size by doubling it. Returns the new
+ * size or 0 when EXP_NC_MAX was reached */
+static unsigned _nc_grow(unsigned numof)
+{
+    unsigned size;
+
+    if (numof >= EXP_NC_MAX) {
+        return 0;
+    }
+    size = (numof < EXP_NC_MIN) ? EXP_NC_MIN : 2 * numof;
+    if (size > EXP_NC_MAX) {
+        size = EXP_NC_MAX;
+    }
+    for (; numof < size; numof++) {
+        ipv6_addr_t addr;
+        uint8_t l2_addr[sizeof(dst_l2)];
+
+        _nc_neighbor(numof, &addr, l2_addr);
+        stack_add_neighbor(0, &addr, l2_addr, sizeof(l2_addr));
+    }
+    return size;
+}
+#endif
+
+static inline void _prepare_payload(unsigned id)
+{
+    for (unsigned j = 0; j < (payload_size - TAIL_LEN); j++) {
+        payload_buffer[j] = id & 0xff;
+    }
+    memcpy((uint16_t *)&payload_buffer[payload_size - TAIL_LEN],
+           &payload_size, sizeof(uint16_t));
+    memcpy(&payload_buffer[payload_size - HONEYGUIDE_LEN], honeyguide,
+           sizeof(honeyguide));
+}
+
+/* sends EXP_RUNS packets per payload size */
+static void _send_all(void)
 {
     ipv6_addr_t unspec = IPV6_ADDR_UNSPECIFIED;
 
+    for (payload_size = EXP_MIN_PAYLOAD; payload_size <= EXP_MAX_PAYLOAD;
+         payload_size += EXP_PAYLOAD_STEP) {
+        for (unsigned id = 0; id < EXP_RUNS; id++) {
+            _prepare_payload(id);
+#ifdef EXP_NC
+            /* a random neighbor, so a cache in front of the neighbor cache
+             * does not help */
+            _nc_neighbor(random_uint32() % neighbors, &dst, NULL);
+#endif
+            probe_set_id(id);
+            timer_window[id % TIMER_WINDOW_SIZE] = timing_now();
+            probe_record(PROBE_CONN_UDP);
+            conn_udp_sendto(payload_buffer, payload_size, &unspec, sizeof(unspec),
+                            &dst, sizeof(dst), AF_INET6, EXP_SRC_PORT, EXP_DST_PORT);
+            probe_flush(payload_size);
+            output_flush(false);
+#if EXP_PACKET_DELAY
+            xtimer_usleep(EXP_PACKET_DELAY);
+#endif
+        }
+#ifdef EXP_PKTBUF
+        printf("%u,%u,%u,%u\n", (unsigned)payload_size, (unsigned)EXP_RUNS,
+               (unsigned)EXP_RUNS - delivered, (unsigned)stack_pktbuf_peak());
+        delivered = 0;
+#endif
+        output_step(payload_size);
+    }
+    output_flush(true);
+}
+
+#ifdef EXP_SATURATION
+/* runs with a priority above the stack's threads, so a burst is handed to
+ * the stack before it gets the chance to process it. Failed allocations in the
+ * packet buffer are reported by conn_udp_sendto() as -ENOMEM, while full
+ * message queues drop packets silently, so they are only visible as `dropped`
+ * (accepted, but never completed by the device). */
+static void *_saturation_thread(void *arg)
+{
+    ipv6_addr_t unspec = IPV6_ADDR_UNSPECIFIED;
+
+    (void)arg;
+    puts("payload_len,sent,enomem,errors,completed,dropped,duration_us,"
+         "packets_per_s,bytes_per_s");
+    for (payload_size = EXP_MIN_PAYLOAD; payload_size <= EXP_MAX_PAYLOAD;
+         payload_size += EXP_PAYLOAD_STEP) {
+        uint32_t enomem = 0, errors = 0, last;
+        uint64_t pps = 0, bps = 0;
+
+        _prepare_payload(0);
+        completed = 0;
+        duration = 0;
+        last_completion = timing_now();
+        for (unsigned id = 0; id < EXP_RUNS; id++) {
+            int res = conn_udp_sendto(payload_buffer, payload_size, &unspec,
+                                      sizeof(unspec), &dst, sizeof(dst),
+                                      AF_INET6, EXP_SRC_PORT, EXP_DST_PORT);
+            if (res == -ENOMEM) {
+                enomem++;
+            }
+            else if (res < 0) {
+                errors++;
+            }
+            if (((id + 1) % EXP_SATURATION_BURST) == 0) {
+                xtimer_usleep(EXP_SATURATION_BURST_DELAY);
+            }
+        }
+        /* wait for the stack to become idle */
+        do {
+            last = completed;
+            xtimer_usleep(EXP_SATURATION_IDLE);
+        } while (last != completed);
+        if (duration > 0) {
+            pps = ((uint64_t)completed * TIMING_HZ) / duration;
+            bps = ((uint64_t)completed * payload_size * TIMING_HZ) / duration;
+        }
+        printf("%u,%u,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32
+               ",%" PRIu32 ",%" PRIu32 "\n", (unsigned)payload_size,
+               (unsigned)EXP_RUNS, enomem, errors, completed,
+               EXP_RUNS - enomem - errors - completed,
+               (uint32_t)((duration * 1000000U) / TIMING_HZ),
+               (uint32_t)pps, (uint32_t)bps);
+    }
+    sema_post(&sync);
+    return NULL;
+}
+#endif
+
+void exp_run(void)
+{
+    probe_init(PROBE_DIR_TX);
     netdev2_test_set_send_cb(&netdevs[0], _netdev2_send);
     stack_add_neighbor(0, &dst, dst_l2, sizeof(dst_l2));
+#ifdef MODULE_RANDOM
+    random_init(EXP_SEED);
+#endif
 #ifdef STACK_MULTIHOP
     const ipv6_addr_t *gua;
+    ipv6_addr_t unspec = IPV6_ADDR_UNSPECIFIED;
     ipv6_addr_t prefix = EXP_PREFIX;
+#ifdef EXP_FIB
+    const ipv6_addr_t next_hop = dst;
+#endif
     gua = stack_add_prefix(0, &prefix, EXP_PREFIX_LEN);
     stack_add_route(0, &unspec, 0, &dst);
 #ifdef STACK_RPL
@@ -101,36 +338,58 @@ void exp_run(void)
     ipv6_addr_init_prefix(&dst, &prefix, EXP_PREFIX_LEN);
 #endif
 
-#ifdef EXP_STACKTEST
-    puts("thread,stack_size,stack_free");
+#if defined(EXP_SATURATION)
+    if (thread_create(thread_stack, sizeof(thread_stack), THREAD_PRIO,
+                      THREAD_CREATE_STACKTEST, _saturation_thread, NULL,
+                      "exp_sender") < 0) {
+        return;
+    }
+    sema_wait(&sync);
 #else
-    puts("payload_len,tx_traversal_time");
+#if defined(EXP_STACKTEST)
+    puts("thread,stack_size,stack_free");
+#elif defined(EXP_PROBES)
+    probe_print_header();
+#elif defined(EXP_PKTBUF)
+    puts("payload_len,runs,lost," STACK_PKTBUF_NAME "_peak");
+    (void)stack_pktbuf_peak();  /* reset after the set-up */
+#elif !defined(EXP_FIB) && !defined(EXP_NC)
+    output_init("tx_traversal");
 #endif
-    for (payload_size = EXP_MIN_PAYLOAD; payload_size <= EXP_MAX_PAYLOAD;
-         payload_size += EXP_PAYLOAD_STEP) {
-        for (unsigned id = 0; id < EXP_RUNS; id++) {
-            for (unsigned j = 0; j < (payload_size - TAIL_LEN); j++) {
-                payload_buffer[j] = id & 0xff;
-            }
-            memcpy((uint16_t *)&payload_buffer[payload_size - TAIL_LEN],
-                   &payload_size, sizeof(uint16_t));
-            memcpy(&payload_buffer[payload_size - HONEYGUIDE_LEN], honeyguide,
-                   sizeof(honeyguide));
-            timer_window[id % TIMER_WINDOW_SIZE] = xtimer_now();
-            conn_udp_sendto(payload_buffer, payload_size, &unspec, sizeof(unspec),
-                            &dst, sizeof(dst), AF_INET6, EXP_SRC_PORT, EXP_DST_PORT);
-#if EXP_PACKET_DELAY
-            xtimer_usleep(EXP_PACKET_DELAY);
+#if defined(EXP_FIB)
+    /* one table per FIB size, the metric is named after it */
+    for (unsigned routes = _fib_grow(0, &next_hop); routes > 0;
+         routes = _fib_grow(routes, &next_hop)) {
+#if !defined(EXP_STACKTEST) && !defined(EXP_PROBES) && !defined(EXP_PKTBUF)
+        char name[sizeof("tx_fib65535")];
+
+        sprintf(name, "tx_fib%u", routes);
+        output_init(name);
 #endif
-        }
+        _send_all();
     }
+#elif defined(EXP_NC)
+    /* one table per number of neighbors, the first is the destination */
+    for (neighbors = (EXP_NC_MIN > 1) ? _nc_grow(1) : 1; neighbors > 0;
+         neighbors = _nc_grow(neighbors)) {
+#if !defined(EXP_STACKTEST) && !defined(EXP_PROBES) && !defined(EXP_PKTBUF)
+        char name[sizeof("tx_nc65535")];
+
+        sprintf(name, "tx_nc%u", neighbors);
+        output_init(name);
+#endif
+        _send_all();
+    }
+#else
+    _send_all();
+#endif
+#endif
 #ifdef EXP_STACKTEST
     for (kernel_pid_t i = 0; i <= KERNEL_PID_LAST; i++) {
         const thread_t *p = (thread_t *)sched_threads[i];
         if ((p != NULL) &&
             (strcmp(p->name, "idle") != 0) &&
-            (strcmp(p->name, "main") != 0) &&
-            (strcmp(p->name, "exp_receiver") != 0)) {
+            (strcmp(p->name, "main") != 0)) {
             printf("%s,%u,%u\n", p->name, p->stack_size,
                    thread_measure_stack_free(p->stack_start));
         }
@@ -88,6 +88,155 @@ extern "C" {
 #ifndef EXP_PAYLOAD_STEP_DELAY
 #define EXP_PAYLOAD_STEP_DELAY  (64 * 4060)
 #endif
+
+#ifndef EXP_SATURATION_BURST
+#define EXP_SATURATION_BURST    (16U)   /**< packets sent back-to-back */
+#endif
+
+#ifndef EXP_SATURATION_BURST_DELAY
+#define EXP_SATURATION_BURST_DELAY  (100U)  /**< pause after a burst in us */
+#endif
+
+#ifndef EXP_SATURATION_IDLE
+/**
+ * @brief   time in us without completed packets after which the stack is
+ *          considered drained
+ */
+#define EXP_SATURATION_IDLE     (10000U)
+#endif
+
+#ifndef EXP_SATURATION_PRIO
+#define EXP_SATURATION_PRIO     (THREAD_PRIORITY_MAIN - 6)
+#endif
+
+#ifndef EXP_INTERLEAVE
+#define EXP_INTERLEAVE          (1U)    /**< concurrently received datagrams */
+#endif
+
+#ifndef EXP_SEED
+#define EXP_SEED                (1U)    /**< seed for randomized experiments */
+#endif
+
+#ifndef EXP_LOSS
+#define EXP_LOSS                (0U)    /**< received fragments lost in 1/1000 */
+#endif
+
+#ifndef EXP_DUP
+#define EXP_DUP                 (0U)    /**< received fragments duplicated in 1/1000 */
+#endif
+
+#ifndef EXP_STALE_MAX
+/**
+ * @brief   maximum time in us to wait for the stack to release buffers held by
+ *          incomplete reassemblies
+ */
+#define EXP_STALE_MAX           (10000000L)
+#endif
+
+#ifndef EXP_STALE_POLL
+#define EXP_STALE_POLL          (10000L)    /**< poll interval for EXP_STALE_MAX */
+#endif
+
+#ifndef EXP_MULTI_PRIO
+#define EXP_MULTI_PRIO          (THREAD_PRIORITY_MAIN - 6)
+#endif
+
+#ifndef EXP_MULTI_TIMEOUT
+#define EXP_MULTI_TIMEOUT       (100000U)   /**< time in us until a packet is lost */
+#endif
+
+#ifndef EXP_FWD_DST
+/**
+ * @brief   destination of the forwarded datagrams (time_fwd), host route via
+ *          @ref EXP_FWD_NEXT_HOP_L2
+ */
+#define EXP_FWD_DST     { { 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x00, 0x00, 0x00, \
+                            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 } }
+#endif
+
+#ifndef EXP_FWD_NEXT_HOP_L2
+#define EXP_FWD_NEXT_HOP_L2     { 0x02, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xdf }
+#endif
+
+#ifndef EXP_FWD_TIMEOUT
+#define EXP_FWD_TIMEOUT         (100000U)   /**< time in us until a datagram is lost */
+#endif
+
+#ifndef EXP_FIB_MIN
+#define EXP_FIB_MIN             (10U)   /**< first number of routes (time_tx_fib) */
+#endif
+
+#ifndef EXP_FIB_MAX
+#define EXP_FIB_MAX             (500U)  /**< last number of routes (time_tx_fib) */
+#endif
+
+#ifndef EXP_FIB_STEP
+#define EXP_FIB_STEP            (50U)   /**< routes added between measurements */
+#endif
+
+#ifndef EXP_NC_MIN
+#define EXP_NC_MIN              (1U)    /**< first number of neighbors (time_tx_nc) */
+#elif EXP_NC_MIN < 1
+#error "EXP_NC_MIN needs to be at least 1"
+#endif
+
+#ifndef EXP_NC_MAX
+/**
+ * @brief   last number of neighbors (time_tx_nc), the number is doubled
+ *          between measurements
+ */
+#define EXP_NC_MAX              (256U)
+#endif
+
+#ifndef EXP_RPL_DIO_INTERVAL
+/**
+ * @brief   interval in us of the DIOs of the simulated root (rpl_conv)
+ */
+#define EXP_RPL_DIO_INTERVAL    (1000000U)
+#endif
+
+#ifndef EXP_RPL_POLL
+#define EXP_RPL_POLL            (1000U)     /**< poll interval in us for a route */
+#endif
+
+#ifndef EXP_RPL_TIMEOUT
+#define EXP_RPL_TIMEOUT         (60000000U) /**< time in us until joining failed */
+#endif
+
+#ifndef EXP_RPL_STEADY
+/**
+ * @brief   time in us the control traffic is observed after joining
+ */
+#define EXP_RPL_STEADY          (60000000U)
+#endif
+
+/**
+ * @name    Thread stack sizes
+ *
+ * Overridden by the stacksizes.h generated by stacksize.py from the output of
+ * STACKTEST=1 (build with STACKSIZES=1)
+ * @{
+ */
+#ifndef EXP_STACKSIZE_EXP
+/**
+ * @brief   exp_sender, exp_receiver
+ */
+#define EXP_STACKSIZE_EXP       (THREAD_STACKSIZE_DEFAULT + \
+                                 THREAD_EXTRA_STACKSIZE_PRINTF)
+#endif
+
+#ifndef EXP_STACKSIZE_MAC
+#define EXP_STACKSIZE_MAC       (THREAD_STACKSIZE_DEFAULT)  /**< netdev2 (gnrc) */
+#endif
+
+#ifndef EXP_STACKSIZE_PROBE
+#define EXP_STACKSIZE_PROBE     (THREAD_STACKSIZE_DEFAULT)  /**< probe */
+#endif
+
+#ifndef EXP_STACKSIZE_EMB6
+#define EXP_STACKSIZE_EMB6      (THREAD_STACKSIZE_DEFAULT)  /**< emb6 */
+#endif
+/** @} */
 void exp_run(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Compile-time descriptor of the experiment's flow
+ *
+ * All packets of the experiments belong to one UDP flow between link-local
+ * addresses derived from the long link-layer addresses with hop limit 64 and
+ * without traffic class and flow label. For this flow the complete
+ * IPHC and UDP LOWPAN_NHC header is known at compile time, except for the UDP
+ * checksum, so it can be emitted with a copy and a patch and parsed with a
+ * compare (RFC 6282).
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef FLOW_H_
+#define FLOW_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "byteorder.h"
+#include "net/sixlowpan.h"
+
+#include "exp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLOW_HOP_LIMIT      (64U)   /**< hop limit of the flow */
+
+/**
+ * @brief   Compressed UDP ports of the flow
+ */
+#if (((EXP_DST_PORT & 0xfff0) == 0xf0b0) && ((EXP_SRC_PORT & 0xfff0) == 0xf0b0))
+#define FLOW_NHC_PORTS      0xf3, ((EXP_SRC_PORT & 0xf) << 4) | \
+                                  (EXP_DST_PORT & 0xf)
+#define FLOW_NHC_PORTS_LEN  (2U)
+#elif ((EXP_DST_PORT & 0xff00) == 0xf000)
+#define FLOW_NHC_PORTS      0xf1, (EXP_SRC_PORT >> 8), (EXP_SRC_PORT & 0xff), \
+                            (EXP_DST_PORT & 0xff)
+#define FLOW_NHC_PORTS_LEN  (4U)
+#elif ((EXP_SRC_PORT & 0xff00) == 0xf000)
+#define FLOW_NHC_PORTS      0xf2, (EXP_SRC_PORT & 0xff), (EXP_DST_PORT >> 8), \
+                            (EXP_DST_PORT & 0xff)
+#define FLOW_NHC_PORTS_LEN  (4U)
+#else
+#define FLOW_NHC_PORTS      0xf0, (EXP_SRC_PORT >> 8), (EXP_SRC_PORT & 0xff), \
+                            (EXP_DST_PORT >> 8), (EXP_DST_PORT & 0xff)
+#define FLOW_NHC_PORTS_LEN  (5U)
+#endif
+
+/**
+ * @brief   Length of the IPHC and UDP LOWPAN_NHC header of the flow
+ */
+#define FLOW_IPHC_LEN       (2U + FLOW_NHC_PORTS_LEN + sizeof(uint16_t))
+
+/**
+ * @brief   Offset of the inline UDP checksum in the header
+ */
+#define FLOW_CSUM_POS       (FLOW_IPHC_LEN - sizeof(uint16_t))
+
+/**
+ * @brief   Template of the IPHC and UDP LOWPAN_NHC header of the flow
+ *
+ * TF and NH are elided, the hop limit is 64 and the addresses are derived
+ * from the link-layer addresses. The checksum is left zero.
+ */
+static const uint8_t flow_iphc[FLOW_IPHC_LEN] = {
+    SIXLOWPAN_IPHC1_DISP | SIXLOWPAN_IPHC1_TF | SIXLOWPAN_IPHC1_NH | 0x02,
+    SIXLOWPAN_IPHC2_SAM | SIXLOWPAN_IPHC2_DAM,
+    FLOW_NHC_PORTS,
+    0, 0,
+};
+
+/**
+ * @brief   Writes the header of the flow
+ *
+ * @param[out] buf  Buffer of at least @ref FLOW_IPHC_LEN bytes.
+ * @param[in] csum  UDP checksum of the datagram.
+ */
+static inline void flow_iphc_write(uint8_t *buf, network_uint16_t csum)
+{
+    memcpy(buf, flow_iphc, FLOW_CSUM_POS);
+    buf[FLOW_CSUM_POS] = csum.u8[0];
+    buf[FLOW_CSUM_POS + 1] = csum.u8[1];
+}
+
+/**
+ * @brief   Checks if a 6LoWPAN frame starts with the header of the flow
+ *
+ * @param[in] buf   The 6LoWPAN frame.
+ * @param[in] len   Length of @p buf.
+ *
+ * @return  true, if @p buf carries a datagram of the flow.
+ */
+static inline bool flow_iphc_match(const uint8_t *buf, size_t len)
+{
+    return (len >= FLOW_IPHC_LEN) && (memcmp(buf, flow_iphc, FLOW_CSUM_POS) == 0);
+}
+
+/**
+ * @brief   Reads the UDP checksum from the header of the flow
+ *
+ * @param[in] buf   A header matched by @ref flow_iphc_match().
+ *
+ * @return  The UDP checksum.
+ */
+static inline network_uint16_t flow_iphc_csum(const uint8_t *buf)
+{
+    network_uint16_t csum;
+
+    csum.u8[0] = buf[FLOW_CSUM_POS];
+    csum.u8[1] = buf[FLOW_CSUM_POS + 1];
+    return csum;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLOW_H_ */
+/** @} */
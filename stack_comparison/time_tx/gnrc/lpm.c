@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lpm.h"
+
+#ifdef EXP_LPM
+
+#define ADDR_BITS       (8 * sizeof(ipv6_addr_t))
+/* every prefix adds at most a leaf and a branching node */
+#define NODES_NUMOF     (2 * LPM_NUMOF)
+#define NONE            (UINT16_MAX)
+
+typedef struct {
+    ipv6_addr_t prefix;
+    void *value;
+} _prefix_t;
+
+typedef struct {
+    uint16_t key;       /**< prefix of the node or of any node below it */
+    uint16_t child[2];
+    uint8_t len;
+    bool route;         /**< node is the prefix `key` */
+} _node_t;
+
+static _prefix_t _prefixes[LPM_NUMOF];
+static _node_t _nodes[NODES_NUMOF];
+static unsigned _prefixes_numof, _nodes_numof;
+static uint16_t _root = NONE;
+
+static inline unsigned _bit(const ipv6_addr_t *addr, unsigned pos)
+{
+    return (addr->u8[pos >> 3] >> (7 - (pos & 7))) & 1;
+}
+
+/* number of leading bits @p a and @p b have in common, up to @p max, the
+ * first @p from bits are known to match */
+static unsigned _match(const ipv6_addr_t *a, const ipv6_addr_t *b,
+                       unsigned from, unsigned max)
+{
+    unsigned len = from & ~0x7U;
+
+    for (unsigned i = len >> 3; (len < max) && (i < sizeof(ipv6_addr_t)); i++) {
+        uint8_t diff = a->u8[i] ^ b->u8[i];
+
+        if (diff != 0) {
+            while (!(diff & 0x80)) {
+                diff <<= 1;
+                len++;
+            }
+            break;
+        }
+        len += 8;
+    }
+    return (len < max) ? len : max;
+}
+
+static uint16_t _new_prefix(const ipv6_addr_t *prefix, void *value)
+{
+    memcpy(&_prefixes[_prefixes_numof].prefix, prefix, sizeof(ipv6_addr_t));
+    _prefixes[_prefixes_numof].value = value;
+    return _prefixes_numof++;
+}
+
+static uint16_t _new_node(uint16_t key, uint8_t len, bool route)
+{
+    _node_t *node = &_nodes[_nodes_numof];
+
+    node->key = key;
+    node->child[0] = NONE;
+    node->child[1] = NONE;
+    node->len = len;
+    node->route = route;
+    return _nodes_numof++;
+}
+
+int lpm_add(const ipv6_addr_t *prefix, uint8_t prefix_len, void *value)
+{
+    uint16_t *link = &_root;
+    unsigned common = 0;
+
+    if ((prefix_len > ADDR_BITS) || (value == NULL)) {
+        return -EINVAL;
+    }
+    while (*link != NONE) {
+        _node_t *node = &_nodes[*link];
+
+        common = _match(prefix, &_prefixes[node->key].prefix, common,
+                        (node->len < prefix_len) ? node->len : prefix_len);
+        if (common < node->len) {
+            /* the prefix branches off above the node */
+            uint16_t key, branch;
+
+            if ((_prefixes_numof >= LPM_NUMOF) ||
+                ((_nodes_numof + 2) > NODES_NUMOF)) {
+                return -ENOMEM;
+            }
+            key = _new_prefix(prefix, value);
+            branch = _new_node(key, common, common == prefix_len);
+            _nodes[branch].child[_bit(&_prefixes[node->key].prefix, common)] = *link;
+            if (common < prefix_len) {
+                _nodes[branch].child[_bit(prefix, common)] = _new_node(key,
+                                                                       prefix_len,
+                                                                       true);
+            }
+            *link = branch;
+            return 0;
+        }
+        if (node->len == prefix_len) {
+            if (node->route) {
+                _prefixes[node->key].value = value;
+                return 0;
+            }
+            if (_prefixes_numof >= LPM_NUMOF) {
+                return -ENOMEM;
+            }
+            node->key = _new_prefix(prefix, value);
+            node->route = true;
+            return 0;
+        }
+        link = &node->child[_bit(prefix, node->len)];
+    }
+    if ((_prefixes_numof >= LPM_NUMOF) || (_nodes_numof >= NODES_NUMOF)) {
+        return -ENOMEM;
+    }
+    *link = _new_node(_new_prefix(prefix, value), prefix_len, true);
+    return 0;
+}
+
+void *lpm_lookup(const ipv6_addr_t *addr)
+{
+    void *res = NULL;
+    unsigned checked = 0;
+    uint16_t idx = _root;
+
+    while (idx != NONE) {
+        const _node_t *node = &_nodes[idx];
+
+        /* the bits skipped by path compression still have to match */
+        checked = _match(addr, &_prefixes[node->key].prefix, checked,
+                         node->len);
+        if (checked < node->len) {
+            break;
+        }
+        if (node->route) {
+            res = _prefixes[node->key].value;
+        }
+        if (node->len >= ADDR_BITS) {
+            break;
+        }
+        idx = node->child[_bit(addr, node->len)];
+    }
+    return res;
+}
+
+#endif
+
+/** @} */
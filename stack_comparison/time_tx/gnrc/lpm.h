@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Longest-prefix match index for IPv6 routes
+ *
+ * A path-compressed binary trie: every node branches on the first bit after
+ * its prefix, nodes with a single child are left out. A lookup only visits
+ * the nodes on the path to the longest matching prefix, so it depends on the
+ * number of branching points on that path (at most 128, for N random
+ * prefixes about log2(N)) instead of the number of routes like the linear
+ * search of gnrc's FIB and emb6's route table.
+ *
+ * With `EXP_LPM` (`LPM=1` on the make command line, time_tx_fib only)
+ * stack_add_route() adds its routes to the index and the stack's route lookup
+ * is linked to use it first (see the Makefiles of time_tx_fib). Routes are
+ * never removed, so only static routes can be indexed.
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef LPM_H_
+#define LPM_H_
+
+#include <stdint.h>
+
+#include "net/ipv6/addr.h"
+
+#include "exp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LPM_NUMOF
+#define LPM_NUMOF       (EXP_FIB_MAX + 1)   /**< maximum number of prefixes */
+#endif
+
+/**
+ * @brief   Adds a prefix to the index or replaces its value
+ *
+ * @param[in] prefix        The prefix, bits after @p prefix_len are ignored.
+ * @param[in] prefix_len    Length of @p prefix in bits.
+ * @param[in] value         Value to return for the prefix, must not be NULL.
+ *
+ * @return  0 on success
+ * @return  -ENOMEM if the index is full
+ */
+int lpm_add(const ipv6_addr_t *prefix, uint8_t prefix_len, void *value);
+
+/**
+ * @brief   Looks up the value of the longest prefix matching @p addr
+ *
+ * @return  The value of the prefix, NULL if no prefix matches.
+ */
+void *lpm_lookup(const ipv6_addr_t *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LPM_H_ */
+/** @} */
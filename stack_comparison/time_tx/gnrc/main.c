@@ -19,19 +19,31 @@
 #include "xtimer.h"
 
 #include "netdev.h"
+#include "output.h"
 #include "stack.h"
 #include "exp.h"
+#include "timing.h"
 
 #define MAIN_MSG_QUEUE_SIZE (8)
 
 static msg_t main_msg_queue[MAIN_MSG_QUEUE_SIZE];
 
 int main(void) {
+    uint32_t start;
+
     printf("%s started\n", APPLICATION_NAME);
     xtimer_init();
+    timing_init();
     msg_init_queue(main_msg_queue, MAIN_MSG_QUEUE_SIZE);
     netdev_init();
+    start = timing_now();
     stack_init();
+    /* stack_init() returns when the stack is ready to send, the startup time
+     * is reported like a latency for payload length 0 */
+    output_init("startup");
+    output_record(0, 0, timing_now() - start);
+    output_step(0);
+    output_flush(true);
     exp_run();
     printf("%s stopped\n", APPLICATION_NAME);
     return 0;
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "nc_hash.h"
+
+#ifdef EXP_NC_HASH
+
+typedef struct {
+    ipv6_addr_t addr;
+    void *value;        /**< NULL for a free slot */
+} _slot_t;
+
+static _slot_t _slots[NC_HASH_SIZE];
+
+/* neighbors mostly differ in the last bytes of their IID, so all of the
+ * address is folded before the multiplicative hash spreads it */
+static unsigned _hash(const ipv6_addr_t *addr)
+{
+    uint32_t h = addr->u32[0].u32 ^ addr->u32[1].u32 ^ addr->u32[2].u32 ^
+                 addr->u32[3].u32;
+
+    h *= 2654435761U;
+    return (h ^ (h >> 16)) % NC_HASH_SIZE;
+}
+
+/* slot of @p addr or the free slot it would go to, NULL if the table is full
+ * without @p addr */
+static _slot_t *_find(const ipv6_addr_t *addr)
+{
+    unsigned idx = _hash(addr);
+
+    for (unsigned i = 0; i < NC_HASH_SIZE; i++) {
+        _slot_t *slot = &_slots[idx];
+
+        if ((slot->value == NULL) || ipv6_addr_equal(&slot->addr, addr)) {
+            return slot;
+        }
+        if (++idx >= NC_HASH_SIZE) {
+            idx = 0;
+        }
+    }
+    return NULL;
+}
+
+int nc_hash_add(const ipv6_addr_t *addr, void *value)
+{
+    _slot_t *slot;
+
+    if (value == NULL) {
+        return -EINVAL;
+    }
+    if ((slot = _find(addr)) == NULL) {
+        return -ENOMEM;
+    }
+    memcpy(&slot->addr, addr, sizeof(ipv6_addr_t));
+    slot->value = value;
+    return 0;
+}
+
+void *nc_hash_lookup(const ipv6_addr_t *addr)
+{
+    _slot_t *slot = _find(addr);
+
+    return (slot != NULL) ? slot->value : NULL;
+}
+
+#endif
+
+/** @} */
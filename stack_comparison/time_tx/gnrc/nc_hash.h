@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Hashed index for neighbor cache entries
+ *
+ * An open-addressing hash table with linear probing from IPv6 addresses to
+ * the entries of the stack's neighbor cache. gnrc and lwIP search their
+ * neighbor caches linearly for every packet, which does not scale to the
+ * hundreds of neighbors a border router of a dense deployment sees. The
+ * index keeps the lookup at about one probe as long as it is at most half
+ * full.
+ *
+ * With `EXP_NC_HASH` (`NC_HASH=1` on the make command line, time_tx_nc only)
+ * stack_add_neighbor() adds its entries to the index and the stack's neighbor
+ * lookup is linked to use it first (see the Makefiles of time_tx_nc). Entries
+ * are never removed, the stack's wrapper has to check if an entry still
+ * belongs to the address.
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef NC_HASH_H_
+#define NC_HASH_H_
+
+#include "net/ipv6/addr.h"
+
+#include "exp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NC_HASH_SIZE
+#define NC_HASH_SIZE    (2 * EXP_NC_MAX)    /**< number of slots */
+#endif
+
+/**
+ * @brief   Adds an address to the index or replaces its value
+ *
+ * @param[in] addr      The address of the neighbor.
+ * @param[in] value     Value to return for the address, must not be NULL.
+ *
+ * @return  0 on success
+ * @return  -ENOMEM if the index is full
+ */
+int nc_hash_add(const ipv6_addr_t *addr, void *value);
+
+/**
+ * @brief   Looks up the value of @p addr
+ *
+ * @return  The value of the address, NULL if it is not in the index.
+ */
+void *nc_hash_lookup(const ipv6_addr_t *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NC_HASH_H_ */
+/** @} */
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "irq.h"
+
+#include "output.h"
+#include "stats.h"
+#include "timing.h"
+
+#if defined(EXP_STATS)
+static stats_t _stats;
+#elif defined(EXP_OUTPUT_BINARY)
+#define FRAME_HDR_LEN       (7U)
+#define FRAME_RECORD_LEN    (8U)
+#define FRAME_MAX_LEN       (FRAME_HDR_LEN + \
+                             (OUTPUT_FRAME_RECORDS * FRAME_RECORD_LEN) + \
+                             sizeof(uint16_t))
+#define FRAME_B64_LEN       (((FRAME_MAX_LEN + 2) / 3) * 4)
+
+typedef struct {
+    uint32_t ticks;
+    uint16_t payload_len;
+    uint16_t id;
+} _record_t;
+
+static const char _b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                           "abcdefghijklmnopqrstuvwxyz0123456789+/";
+static _record_t _records[OUTPUT_BUF_SIZE];
+static unsigned _head = 0, _numof = 0, _overflows = 0;
+static uint8_t _frame[FRAME_MAX_LEN];
+static char _line[sizeof(OUTPUT_FRAME_PREFIX) + FRAME_B64_LEN];
+
+static void _print_frame(unsigned count);
+#endif
+
+void output_init(const char *name)
+{
+#ifdef EXP_STATS
+    static const char *columns[] = { "min", "max", "mean", "stddev",
+                                     "p50", "p90", "p99" };
+
+    stats_init(&_stats);
+    printf("payload_len,runs");
+    for (unsigned i = 0; i < (sizeof(columns) / sizeof(columns[0])); i++) {
+        printf(",%s_%s_ns", name, columns[i]);
+    }
+    puts("");
+#else
+    printf("payload_len,%s_ticks,%s_ns\n", name, name);
+#endif
+}
+
+void output_record(uint16_t payload_len, uint16_t id, uint32_t ticks)
+{
+#if defined(EXP_STATS)
+    unsigned state = disableIRQ();
+
+    (void)payload_len;
+    (void)id;
+    stats_add(&_stats, ticks);
+    restoreIRQ(state);
+#elif defined(EXP_OUTPUT_BINARY)
+    unsigned state = disableIRQ();
+
+    if (_numof >= OUTPUT_BUF_SIZE) {
+        _overflows++;
+    }
+    else {
+        _record_t *r = &_records[(_head + _numof) % OUTPUT_BUF_SIZE];
+        r->ticks = ticks;
+        r->payload_len = payload_len;
+        r->id = id;
+        _numof++;
+    }
+    restoreIRQ(state);
+#else
+    (void)id;
+    printf("%u,%" PRIu32 ",%" PRIu64 "\n", (unsigned)payload_len, ticks,
+           timing_ticks_to_ns(ticks));
+#endif
+}
+
+void output_flush(bool all)
+{
+#if defined(EXP_OUTPUT_BINARY) && !defined(EXP_STATS)
+    unsigned numof, overflows, state;
+
+    /* writers only append behind _numof, so the records up to there can be read
+     * without blocking them */
+    state = disableIRQ();
+    numof = _numof;
+    overflows = _overflows;
+    _overflows = 0;
+    restoreIRQ(state);
+    if (overflows > 0) {
+        printf("# output buffer overflowed %u times\n", overflows);
+    }
+    while ((numof >= OUTPUT_FRAME_RECORDS) || (all && (numof > 0))) {
+        unsigned count = (numof < OUTPUT_FRAME_RECORDS) ? numof :
+                         OUTPUT_FRAME_RECORDS;
+
+        _print_frame(count);
+        numof -= count;
+        state = disableIRQ();
+        _head = (_head + count) % OUTPUT_BUF_SIZE;
+        _numof -= count;
+        restoreIRQ(state);
+    }
+#else
+    (void)all;
+#endif
+}
+
+void output_step(uint16_t payload_len)
+{
+#ifdef EXP_STATS
+    uint32_t summary[7], count;
+    unsigned state = disableIRQ();
+
+    count = _stats.count;
+    summary[0] = (count > 0) ? _stats.min : 0;
+    summary[1] = _stats.max;
+    summary[2] = (uint32_t)_stats.mean;
+    summary[3] = stats_stddev(&_stats);
+    summary[4] = stats_percentile(&_stats, 500);
+    summary[5] = stats_percentile(&_stats, 900);
+    summary[6] = stats_percentile(&_stats, 990);
+    stats_init(&_stats);
+    restoreIRQ(state);
+    printf("%u,%" PRIu32, (unsigned)payload_len, count);
+    for (unsigned i = 0; i < (sizeof(summary) / sizeof(summary[0])); i++) {
+        printf(",%" PRIu64, timing_ticks_to_ns(summary[i]));
+    }
+    puts("");
+#else
+    (void)payload_len;
+#endif
+}
+
+#if defined(EXP_OUTPUT_BINARY) && !defined(EXP_STATS)
+static inline uint8_t *_put_u16(uint8_t *ptr, uint16_t val)
+{
+    ptr[0] = val & 0xff;
+    ptr[1] = val >> 8;
+    return ptr + sizeof(uint16_t);
+}
+
+static inline uint8_t *_put_u32(uint8_t *ptr, uint32_t val)
+{
+    ptr = _put_u16(ptr, val & 0xffff);
+    return _put_u16(ptr, val >> 16);
+}
+
+static uint16_t _fletcher16(const uint8_t *data, size_t len)
+{
+    uint16_t sum1 = 0, sum2 = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        sum1 = (sum1 + data[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+static void _base64(char *out, const uint8_t *in, size_t len)
+{
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t block = in[i] << 16;
+
+        if ((i + 1) < len) {
+            block |= in[i + 1] << 8;
+        }
+        if ((i + 2) < len) {
+            block |= in[i + 2];
+        }
+        *(out++) = _b64[(block >> 18) & 0x3f];
+        *(out++) = _b64[(block >> 12) & 0x3f];
+        *(out++) = ((i + 1) < len) ? _b64[(block >> 6) & 0x3f] : '=';
+        *(out++) = ((i + 2) < len) ? _b64[block & 0x3f] : '=';
+    }
+    *out = '\0';
+}
+
+static void _print_frame(unsigned count)
+{
+    uint8_t *ptr = _frame;
+
+    *(ptr++) = OUTPUT_FRAME_VERSION;
+    *(ptr++) = 0;   /* flags */
+    *(ptr++) = count;
+    ptr = _put_u32(ptr, TIMING_HZ);
+    for (unsigned i = 0; i < count; i++) {
+        const _record_t *r = &_records[(_head + i) % OUTPUT_BUF_SIZE];
+
+        ptr = _put_u16(ptr, r->payload_len);
+        ptr = _put_u16(ptr, r->id);
+        ptr = _put_u32(ptr, r->ticks);
+    }
+    ptr = _put_u16(ptr, _fletcher16(_frame, ptr - _frame));
+    _line[0] = OUTPUT_FRAME_PREFIX[0];
+    _base64(&_line[1], _frame, ptr - _frame);
+    puts(_line);
+}
+#endif
+
+/** @} */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Result output of the experiments
+ *
+ * By default every result is printed as a CSV row right away. With
+ * `EXP_OUTPUT_BINARY` (`OUTPUT=bin` on the make command line) results are
+ * buffered in RAM as binary records and printed in bulk as frames by
+ * @ref output_flush(), so no formatting happens in the measured path.
+ *
+ * A frame is printed as one line consisting of @ref OUTPUT_FRAME_PREFIX and
+ * the base64 encoding of (all little-endian)
+ *
+ *      | version (1) | flags (1) | count (1) | ticks_hz (4) |
+ *      | count * (payload_len (2) | id (2) | ticks (4)) | fletcher16 (2) |
+ *
+ * where the Fletcher-16 checksum covers all preceding bytes of the frame.
+ * `decode.py` converts the frames back to the CSV rows of the default
+ * output.
+ *
+ * With `EXP_STATS` (`STATS=1` on the make command line) results are only
+ * accumulated and @ref output_step() prints one summary row per payload size
+ * with count, minimum, maximum, mean, standard deviation and the 50th, 90th
+ * and 99th percentile.
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef OUTPUT_BUF_SIZE
+#define OUTPUT_BUF_SIZE         (128U)  /**< number of buffered records */
+#endif
+
+#ifndef OUTPUT_FRAME_RECORDS
+#define OUTPUT_FRAME_RECORDS    (32U)   /**< maximum records per frame */
+#endif
+
+#define OUTPUT_FRAME_PREFIX     "@"     /**< marks a frame line */
+#define OUTPUT_FRAME_VERSION    (1U)    /**< version of the frame format */
+
+/**
+ * @brief   Prints the CSV header and resets the output
+ *
+ * @param[in] name  Name of the measured value, e.g. "tx_traversal".
+ */
+void output_init(const char *name);
+
+/**
+ * @brief   Outputs a result
+ *
+ * @param[in] payload_len   Payload length of the packet.
+ * @param[in] id            ID of the packet.
+ * @param[in] ticks         Measured time in ticks of the clock source.
+ */
+void output_record(uint16_t payload_len, uint16_t id, uint32_t ticks);
+
+/**
+ * @brief   Prints buffered results
+ *
+ * Must be called outside of the measured path.
+ *
+ * @param[in] all   Print incomplete frames, too.
+ */
+void output_flush(bool all);
+
+/**
+ * @brief   Finishes the results of a payload size
+ *
+ * Must be called outside of the measured path.
+ *
+ * @param[in] payload_len   The payload size.
+ */
+void output_step(uint16_t payload_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OUTPUT_H_ */
+/** @} */
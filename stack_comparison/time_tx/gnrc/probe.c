@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "irq.h"
+
+#include "probe.h"
+#include "timing.h"
+
+#ifdef EXP_PROBES
+
+#define _DONE   (PROBE_LAYER_NUMOF)
+
+typedef struct {
+    uint32_t time;
+    uint16_t id;
+    uint8_t layer;
+} _record_t;
+
+static const char *_layer_names[] = {
+    "conn_udp", "udp", "ipv6", "sixlowpan", "netdev2"
+};
+static _record_t _ring[PROBE_RING_SIZE];
+static unsigned _head = 0, _numof = 0, _overflows = 0;
+static uint16_t _id = 0;
+
+static inline void _record(uint8_t layer);
+static void _print_row(uint16_t payload_len, uint16_t id,
+                       const uint32_t *spent, const bool *valid,
+                       uint32_t total);
+
+void probe_init(probe_dir_t dir)
+{
+    unsigned state;
+
+    /* the records are in the order of the path either way */
+    (void)dir;
+    state = disableIRQ();
+    _head = 0;
+    _numof = 0;
+    _overflows = 0;
+    restoreIRQ(state);
+}
+
+void probe_set_id(uint16_t id)
+{
+    _id = id;
+}
+
+uint16_t probe_get_id(void)
+{
+    return _id;
+}
+
+void probe_record(probe_layer_t layer)
+{
+    _record(layer);
+}
+
+void probe_done(void)
+{
+    _record(_DONE);
+}
+
+void probe_print_header(void)
+{
+    printf("payload_len,id,total_ns");
+    for (unsigned i = 0; i < PROBE_LAYER_NUMOF; i++) {
+        printf(",%s_ns", _layer_names[i]);
+    }
+    puts("");
+}
+
+void probe_flush(uint16_t payload_len)
+{
+    uint32_t spent[PROBE_LAYER_NUMOF];
+    bool valid[PROBE_LAYER_NUMOF];
+    uint32_t first = 0, since = 0;
+    int id = -1, layer = -1, caller = -1;
+    unsigned numof, overflows, state;
+
+    /* writers only append behind _numof, so the records up to there can be read
+     * without blocking them */
+    state = disableIRQ();
+    numof = _numof;
+    overflows = _overflows;
+    _overflows = 0;
+    restoreIRQ(state);
+    if (overflows > 0) {
+        printf("# probe ring overflowed %u times\n", overflows);
+    }
+    for (unsigned i = 0; i < numof; i++) {
+        const _record_t *r = &_ring[(_head + i) % PROBE_RING_SIZE];
+
+        if ((id >= 0) && (r->id != id)) {
+            _print_row(payload_len, id, spent, valid, since - first);
+            id = -1;
+        }
+        if (id < 0) {
+            for (unsigned j = 0; j < PROBE_LAYER_NUMOF; j++) {
+                spent[j] = 0;
+                valid[j] = false;
+            }
+            id = r->id;
+            first = r->time;
+            layer = -1;
+            caller = -1;
+        }
+        else if (layer >= 0) {
+            spent[layer] += r->time - since;
+        }
+        since = r->time;
+        if (r->layer == _DONE) {
+            /* back in the layer that called the last one, e.g. 6LoWPAN
+             * preparing the next fragment */
+            layer = caller;
+            caller = -1;
+        }
+        else {
+            caller = layer;
+            layer = r->layer;
+            valid[layer] = true;
+        }
+    }
+    if (id >= 0) {
+        _print_row(payload_len, id, spent, valid, since - first);
+    }
+    state = disableIRQ();
+    _head = (_head + numof) % PROBE_RING_SIZE;
+    _numof -= numof;
+    restoreIRQ(state);
+}
+
+static inline void _record(uint8_t layer)
+{
+    const uint32_t now = timing_now();
+    unsigned state = disableIRQ();
+    _record_t *r;
+
+    if (_numof >= PROBE_RING_SIZE) {
+        /* drop newest record, so probe_flush() can read without locking */
+        _overflows++;
+        restoreIRQ(state);
+        return;
+    }
+    r = &_ring[(_head + _numof) % PROBE_RING_SIZE];
+    r->time = now;
+    r->id = _id;
+    r->layer = layer;
+    _numof++;
+    restoreIRQ(state);
+}
+
+static void _print_row(uint16_t payload_len, uint16_t id,
+                       const uint32_t *spent, const bool *valid,
+                       uint32_t total)
+{
+    printf("%u,%u,%" PRIu64, (unsigned)payload_len, (unsigned)id,
+           timing_ticks_to_ns(total));
+    for (unsigned i = 0; i < PROBE_LAYER_NUMOF; i++) {
+        if (valid[i]) {
+            printf(",%" PRIu64, timing_ticks_to_ns(spent[i]));
+        }
+        else {
+            printf(",");
+        }
+    }
+    puts("");
+}
+
+#endif
+
+/** @} */
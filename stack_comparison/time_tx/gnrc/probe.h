@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Per-layer timestamp probes
+ *
+ * Every probe marks the point in time a packet entered a layer. The time a
+ * packet spent in a layer is the sum of the intervals from the layer's probes
+ * to the packet's next probe, so layers a stack does not expose are accounted
+ * to the previous layer that it does. @ref probe_done() marks that the packet
+ * left the last layer and returned to the layer that called it, e.g. every
+ * fragment's driver send is timed on its own and the time between them is
+ * accounted to 6LoWPAN.
+ *
+ * Probes are only compiled in with `EXP_PROBES` (`PROBES=1` on the make
+ * command line).
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef PROBE_H_
+#define PROBE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef PROBE_RING_SIZE
+#define PROBE_RING_SIZE     (64U)   /**< number of records in the probe ring */
+#endif
+
+/**
+ * @brief   Layer boundaries a probe can be placed at
+ *
+ * In order of a packet's path when sending.
+ */
+typedef enum {
+    PROBE_CONN_UDP = 0,
+    PROBE_UDP,
+    PROBE_IPV6,
+    PROBE_SIXLOWPAN,
+    PROBE_NETDEV2,
+    PROBE_LAYER_NUMOF,
+} probe_layer_t;
+
+/**
+ * @brief   Direction of the packets' path through the stack
+ */
+typedef enum {
+    PROBE_DIR_TX = 0,   /**< from @ref PROBE_CONN_UDP to @ref PROBE_NETDEV2 */
+    PROBE_DIR_RX,       /**< from @ref PROBE_NETDEV2 to @ref PROBE_CONN_UDP */
+} probe_dir_t;
+
+#ifdef EXP_PROBES
+/**
+ * @brief   Initializes the probe ring
+ *
+ * @param[in] dir   Direction of the experiment.
+ */
+void probe_init(probe_dir_t dir);
+
+/**
+ * @brief   Sets the ID of the packet subsequent probes are recorded for
+ */
+void probe_set_id(uint16_t id);
+
+/**
+ * @brief   Gets the ID of the packet probes are currently recorded for
+ */
+uint16_t probe_get_id(void);
+
+/**
+ * @brief   Records that the current packet entered @p layer
+ */
+void probe_record(probe_layer_t layer);
+
+/**
+ * @brief   Records that the current packet left the last layer on its path
+ */
+void probe_done(void);
+
+/**
+ * @brief   Prints the CSV header of the per-layer output
+ */
+void probe_print_header(void);
+
+/**
+ * @brief   Prints one CSV row per packet currently in the ring and empties it
+ *
+ * Must be called outside of the measured path.
+ *
+ * @param[in] payload_len   Payload length of the recorded packets.
+ */
+void probe_flush(uint16_t payload_len);
+#else
+static inline void probe_init(probe_dir_t dir)
+{
+    (void)dir;
+}
+
+static inline void probe_set_id(uint16_t id)
+{
+    (void)id;
+}
+
+static inline uint16_t probe_get_id(void)
+{
+    return 0;
+}
+
+static inline void probe_record(probe_layer_t layer)
+{
+    (void)layer;
+}
+
+static inline void probe_done(void)
+{
+}
+
+static inline void probe_print_header(void)
+{
+}
+
+static inline void probe_flush(uint16_t payload_len)
+{
+    (void)payload_len;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROBE_H_ */
+/** @} */
@@ -14,10 +14,15 @@
  */
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
 
 #ifdef STACK_MULTIHOP
 #include "net/fib.h"
 #endif
+#ifdef EXP_FLOW
+#include "net/protnum.h"
+#endif
 #include "net/gnrc/ipv6.h"
 #include "net/gnrc/netdev2/ieee802154.h"
 #ifdef STACK_RPL
@@ -28,26 +33,312 @@
 #include "net/gnrc.h"
 #include "thread.h"
 
+#include "exp.h"
+#ifdef EXP_FLOW
+#include "flow.h"
+#endif
+#ifdef EXP_LPM
+#include "lpm.h"
+#endif
+#ifdef EXP_NC_HASH
+#include "nc_hash.h"
+#endif
 #include "netdev.h"
+#include "probe.h"
 
 #include "stack.h"
 
 #define ENABLE_DEBUG    (0)
 #include "debug.h"
 
-#define _MAC_STACKSIZE      (THREAD_STACKSIZE_DEFAULT)
+#define _MAC_STACKSIZE      (EXP_STACKSIZE_MAC)
+/* gnrc_pktbuf_static aligns its chunks to the size of its free list entries */
+#define _PKTBUF_ALIGN       (sizeof(void *) + sizeof(unsigned int))
 #define _MAC_PRIO           (THREAD_PRIORITY_MAIN - 4)
 
-static char _mac_stacks[_MAC_STACKSIZE][NETDEV_NUMOF];
+static char _mac_stacks[NETDEV_NUMOF][_MAC_STACKSIZE];
 static gnrc_netdev2_t _gnrc_adapters[NETDEV_NUMOF];
 static kernel_pid_t _pids[NETDEV_NUMOF];
+static size_t _pktbuf_peak;
+
+#ifdef EXP_FLOW
+static char _flow_stack[GNRC_SIXLOWPAN_STACK_SIZE];
+static msg_t _flow_queue[GNRC_SIXLOWPAN_MSG_QUEUE_SIZE];
+static gnrc_netreg_entry_t _flow_entry = { NULL, GNRC_NETREG_DEMUX_CTX_ALL,
+                                           KERNEL_PID_UNDEF };
+static kernel_pid_t _sixlowpan_pid;
+static ipv6_addr_t _flow_src[NETDEV_NUMOF];
+static uint16_t _flow_max_len[NETDEV_NUMOF];
+
+static int _flow_iface(kernel_pid_t pid)
+{
+    for (unsigned i = 0; i < NETDEV_NUMOF; i++) {
+        if (_pids[i] == pid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void _flow_addr(ipv6_addr_t *addr, const uint8_t *l2_addr)
+{
+    ipv6_addr_set_link_local_prefix(addr);
+    memcpy(&addr->u64[1], l2_addr, sizeof(addr->u64[1]));
+    addr->u8[8] ^= 0x02;
+}
+
+/* replaces the IPv6 and UDP header of a packet of the flow by the header
+ * template, returns NULL if the packet is not of the flow */
+static gnrc_pktsnip_t *_flow_compress(gnrc_pktsnip_t *pkt)
+{
+    gnrc_netif_hdr_t *netif_hdr = pkt->data;
+    gnrc_pktsnip_t *ipv6 = pkt->next, *udp, *sixlowpan;
+    ipv6_hdr_t *ipv6_hdr;
+    udp_hdr_t *udp_hdr;
+    ipv6_addr_t dst;
+    int iface = _flow_iface(netif_hdr->if_pid);
+
+    if ((iface < 0) || (pkt->users > 1) || (ipv6 == NULL) ||
+        (ipv6->type != GNRC_NETTYPE_IPV6) || (ipv6->users > 1) ||
+        ((udp = ipv6->next) == NULL) || (udp->type != GNRC_NETTYPE_UDP) ||
+        (udp->users > 1) || (netif_hdr->dst_l2addr_len != sizeof(dst.u64[1]))) {
+        return NULL;
+    }
+    ipv6_hdr = ipv6->data;
+    udp_hdr = udp->data;
+    _flow_addr(&dst, gnrc_netif_hdr_get_dst_addr(netif_hdr));
+    if ((ipv6_hdr->v_tc_fl.u32 != byteorder_htonl(0x60000000).u32) ||
+        (ipv6_hdr->nh != PROTNUM_UDP) || (ipv6_hdr->hl != FLOW_HOP_LIMIT) ||
+        !ipv6_addr_equal(&ipv6_hdr->src, &_flow_src[iface]) ||
+        !ipv6_addr_equal(&ipv6_hdr->dst, &dst) ||
+        (byteorder_ntohs(udp_hdr->src_port) != EXP_SRC_PORT) ||
+        (byteorder_ntohs(udp_hdr->dst_port) != EXP_DST_PORT) ||
+        ((gnrc_pkt_len(udp->next) + FLOW_IPHC_LEN) > _flow_max_len[iface])) {
+        /* other flow or fragmentation needed */
+        return NULL;
+    }
+    sixlowpan = gnrc_pktbuf_add(udp->next, NULL, FLOW_IPHC_LEN,
+                                GNRC_NETTYPE_SIXLOWPAN);
+    if (sixlowpan == NULL) {
+        return NULL;
+    }
+    flow_iphc_write(sixlowpan->data, udp_hdr->checksum);
+    udp->next = NULL;
+    pkt->next = sixlowpan;
+    gnrc_pktbuf_release(ipv6);
+    return pkt;
+}
+
+/* restores the IPv6 and UDP header of a received packet of the flow, returns
+ * NULL if the packet is not of the flow */
+static gnrc_pktsnip_t *_flow_decompress(gnrc_pktsnip_t *pkt)
+{
+    gnrc_pktsnip_t *netif = pkt->next, *ipv6;
+    gnrc_netif_hdr_t *netif_hdr;
+    ipv6_hdr_t *ipv6_hdr;
+    udp_hdr_t *udp_hdr;
+    size_t payload_len;
+
+    if ((netif == NULL) || (netif->type != GNRC_NETTYPE_NETIF) ||
+        (pkt->users > 1) || !flow_iphc_match(pkt->data, pkt->size)) {
+        return NULL;
+    }
+    netif_hdr = netif->data;
+    if ((netif_hdr->src_l2addr_len != sizeof(uint64_t)) ||
+        (netif_hdr->dst_l2addr_len != sizeof(uint64_t))) {
+        return NULL;
+    }
+    payload_len = pkt->size - FLOW_IPHC_LEN;
+    ipv6 = gnrc_pktbuf_add(NULL, NULL, sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t) +
+                           payload_len, GNRC_NETTYPE_IPV6);
+    if (ipv6 == NULL) {
+        return NULL;
+    }
+    ipv6_hdr = ipv6->data;
+    udp_hdr = (udp_hdr_t *)(ipv6_hdr + 1);
+    ipv6_hdr->v_tc_fl = byteorder_htonl(0x60000000);
+    ipv6_hdr->len = byteorder_htons(sizeof(udp_hdr_t) + payload_len);
+    ipv6_hdr->nh = PROTNUM_UDP;
+    ipv6_hdr->hl = FLOW_HOP_LIMIT;
+    _flow_addr(&ipv6_hdr->src, gnrc_netif_hdr_get_src_addr(netif_hdr));
+    _flow_addr(&ipv6_hdr->dst, gnrc_netif_hdr_get_dst_addr(netif_hdr));
+    udp_hdr->src_port = byteorder_htons(EXP_SRC_PORT);
+    udp_hdr->dst_port = byteorder_htons(EXP_DST_PORT);
+    udp_hdr->length = ipv6_hdr->len;
+    udp_hdr->checksum = flow_iphc_csum(pkt->data);
+    memcpy(udp_hdr + 1, ((uint8_t *)pkt->data) + FLOW_IPHC_LEN, payload_len);
+    ipv6->next = gnrc_pktbuf_remove_snip(pkt, pkt);
+    return ipv6;
+}
+
+/* takes the place of the 6LoWPAN thread: packets of the flow are handled by
+ * the header template, all others are handed to gnrc_sixlowpan */
+static void *_flow_thread(void *arg)
+{
+    (void)arg;
+    msg_init_queue(_flow_queue, GNRC_SIXLOWPAN_MSG_QUEUE_SIZE);
+    while (1) {
+        msg_t msg, reply;
+        gnrc_pktsnip_t *pkt, *res;
+
+        msg_receive(&msg);
+        pkt = msg.content.ptr;
+        switch (msg.type) {
+            case GNRC_NETAPI_MSG_TYPE_SND:
+                if ((res = _flow_compress(pkt)) != NULL) {
+                    gnrc_netif_hdr_t *netif_hdr = res->data;
+
+                    gnrc_netapi_send(netif_hdr->if_pid, res);
+                }
+                else {
+                    gnrc_netapi_send(_sixlowpan_pid, pkt);
+                }
+                break;
+            case GNRC_NETAPI_MSG_TYPE_RCV:
+                if ((res = _flow_decompress(pkt)) != NULL) {
+                    if (!gnrc_netapi_dispatch_receive(GNRC_NETTYPE_IPV6,
+                                                      GNRC_NETREG_DEMUX_CTX_ALL,
+                                                      res)) {
+                        gnrc_pktbuf_release(res);
+                    }
+                }
+                else {
+                    gnrc_netapi_receive(_sixlowpan_pid, pkt);
+                }
+                break;
+            case GNRC_NETAPI_MSG_TYPE_GET:
+            case GNRC_NETAPI_MSG_TYPE_SET:
+                reply.type = GNRC_NETAPI_MSG_TYPE_ACK;
+                reply.content.value = -ENOTSUP;
+                msg_reply(&msg, &reply);
+                break;
+            default:
+                break;
+        }
+    }
+    return NULL;
+}
+
+static void _flow_init(void)
+{
+    for (unsigned i = 0; i < NETDEV_NUMOF; i++) {
+        netdev2_t *netdev = (netdev2_t *)&netdevs[i];
+
+        ipv6_addr_set_link_local_prefix(&_flow_src[i]);
+        netdev->driver->get(netdev, NETOPT_IPV6_IID, &_flow_src[i].u64[1],
+                            sizeof(_flow_src[i].u64[1]));
+        netdev->driver->get(netdev, NETOPT_MAX_PACKET_SIZE, &_flow_max_len[i],
+                            sizeof(_flow_max_len[i]));
+    }
+    /* gnrc_sixlowpan stays the fallback, but only reachable over the flow
+     * thread */
+    gnrc_netreg_unregister(GNRC_NETTYPE_SIXLOWPAN,
+                           gnrc_netreg_lookup(GNRC_NETTYPE_SIXLOWPAN,
+                                              GNRC_NETREG_DEMUX_CTX_ALL));
+    _flow_entry.pid = thread_create(_flow_stack, sizeof(_flow_stack),
+                                    GNRC_SIXLOWPAN_PRIO,
+                                    THREAD_CREATE_STACKTEST, _flow_thread,
+                                    NULL, "flow");
+    gnrc_netreg_register(GNRC_NETTYPE_SIXLOWPAN, &_flow_entry);
+}
+#endif
+
+#ifdef EXP_PROBES
+#define _PROBE_STACKSIZE    (EXP_STACKSIZE_PROBE)
+#define _PROBE_PRIO         (THREAD_PRIORITY_MAIN - 5)
+#define _PROBE_QUEUE_SIZE   (8)
+
+static char _probe_stack[_PROBE_STACKSIZE];
+static msg_t _probe_queue[_PROBE_QUEUE_SIZE];
+static gnrc_netreg_entry_t _probe_entries[] = {
+    { NULL, GNRC_NETREG_DEMUX_CTX_ALL, KERNEL_PID_UNDEF },  /* UDP */
+    { NULL, EXP_DST_PORT, KERNEL_PID_UNDEF },               /* UDP */
+    { NULL, GNRC_NETREG_DEMUX_CTX_ALL, KERNEL_PID_UNDEF },  /* IPv6 */
+    { NULL, GNRC_NETREG_DEMUX_CTX_ALL, KERNEL_PID_UNDEF },  /* 6LoWPAN */
+};
+
+/* Since gnrc_netreg prepends new entries and the probe thread has the highest
+ * priority, the probe is dispatched to and scheduled before the layer the
+ * packet is actually handed to. */
+static void *_probe_thread(void *arg)
+{
+    static const probe_layer_t tx_path[] = { PROBE_UDP, PROBE_IPV6,
+                                              PROBE_SIXLOWPAN };
+    unsigned tx_hop = 0;
+    uint16_t tx_id = 0;
+
+    (void)arg;
+    msg_init_queue(_probe_queue, _PROBE_QUEUE_SIZE);
+    while (1) {
+        msg_t msg;
+        gnrc_pktsnip_t *pkt;
+
+        msg_receive(&msg);
+        pkt = msg.content.ptr;
+        switch (msg.type) {
+            case GNRC_NETAPI_MSG_TYPE_SND:
+                /* packet is only extended by headers on its way down, so
+                 * the snip types can't tell the layers apart */
+                if (tx_id != probe_get_id()) {
+                    tx_id = probe_get_id();
+                    tx_hop = 0;
+                }
+                if (tx_hop < (sizeof(tx_path) / sizeof(tx_path[0]))) {
+                    probe_record(tx_path[tx_hop++]);
+                }
+                break;
+            case GNRC_NETAPI_MSG_TYPE_RCV:
+                /* headers are marked on the way up, so the type of the first
+                 * snip tells which layer the packet is handed to */
+                switch (pkt->type) {
+                    case GNRC_NETTYPE_SIXLOWPAN:
+                        probe_record(PROBE_SIXLOWPAN);
+                        break;
+                    case GNRC_NETTYPE_IPV6:
+                        probe_record(PROBE_IPV6);
+                        break;
+                    case GNRC_NETTYPE_UDP:
+                        probe_record(PROBE_UDP);
+                        break;
+                    default:
+                        probe_record(PROBE_CONN_UDP);
+                        break;
+                }
+                break;
+            default:
+                continue;
+        }
+        gnrc_pktbuf_release(pkt);
+    }
+    return NULL;
+}
+
+static void _probe_init(void)
+{
+    kernel_pid_t pid = thread_create(_probe_stack, sizeof(_probe_stack),
+                                     _PROBE_PRIO, THREAD_CREATE_STACKTEST,
+                                     _probe_thread, NULL, "probe");
+
+    for (unsigned i = 0; i < (sizeof(_probe_entries) / sizeof(_probe_entries[0])); i++) {
+        _probe_entries[i].pid = pid;
+    }
+    gnrc_netreg_register(GNRC_NETTYPE_UDP, &_probe_entries[0]);
+    gnrc_netreg_register(GNRC_NETTYPE_UDP, &_probe_entries[1]);
+    gnrc_netreg_register(GNRC_NETTYPE_IPV6, &_probe_entries[2]);
+    gnrc_netreg_register(GNRC_NETTYPE_SIXLOWPAN, &_probe_entries[3]);
+}
+#endif
 
 void stack_init(void)
 {
     /* netdev needs to be set-up */
     assert(netdevs[0].netdev.netdev.driver);
     gnrc_pktbuf_init();
+#ifdef EXP_FLOW
+    _sixlowpan_pid = gnrc_sixlowpan_init();
+#else
     gnrc_sixlowpan_init();
+#endif
     gnrc_ipv6_init();
     gnrc_udp_init();
     for (uint8_t i = 0; i < NETDEV_NUMOF; i++) {
@@ -60,15 +351,180 @@ void stack_init(void)
                                      "netdev2", &_gnrc_adapters[i]);
     }
     gnrc_ipv6_netif_init_by_dev();
+#ifdef EXP_FLOW
+    _flow_init();
+#endif
+#ifdef EXP_PROBES
+    _probe_init();
+#endif
 }
 
+#ifdef EXP_NC_HASH
+gnrc_ipv6_nc_t *__real_gnrc_ipv6_nc_get(kernel_pid_t iface,
+                                       const ipv6_addr_t *ipv6_addr);
+
+/* linked in place of gnrc_ipv6_nc_get() with NC_HASH=1 (see time_tx_nc/gnrc) */
+gnrc_ipv6_nc_t *__wrap_gnrc_ipv6_nc_get(kernel_pid_t iface,
+                                       const ipv6_addr_t *ipv6_addr)
+{
+    gnrc_ipv6_nc_t *entry = nc_hash_lookup(ipv6_addr);
+
+    /* the entry might have been removed and reused since */
+    if ((entry == NULL) || !ipv6_addr_equal(&entry->ipv6_addr, ipv6_addr) ||
+        ((iface != KERNEL_PID_UNDEF) && (entry->iface != iface))) {
+        return __real_gnrc_ipv6_nc_get(iface, ipv6_addr);
+    }
+    return entry;
+}
+#endif
+
 void stack_add_neighbor(int iface, const ipv6_addr_t *ipv6_addr,
                         const uint8_t *l2_addr, uint8_t l2_addr_len)
 {
-    gnrc_ipv6_nc_add(_pids[iface], ipv6_addr, l2_addr, l2_addr_len, 0);
+    gnrc_ipv6_nc_t *entry = gnrc_ipv6_nc_add(_pids[iface], ipv6_addr, l2_addr,
+                                             l2_addr_len, 0);
+
+    if (entry == NULL) {
+        DEBUG("stack: neighbor cache full\n");
+        return;
+    }
+#ifdef EXP_NC_HASH
+    if (nc_hash_add(ipv6_addr, entry) < 0) {
+        DEBUG("stack: no space for neighbor in hash index\n");
+    }
+#endif
+}
+
+static inline size_t _pktbuf_align(size_t size)
+{
+    return (size + _PKTBUF_ALIGN - 1) & ~(_PKTBUF_ALIGN - 1);
+}
+
+size_t stack_pktbuf_used(void)
+{
+    gnrc_pktsnip_t *claimed = NULL, *pkt;
+    size_t unused = 0;
+
+    /* gnrc_pktbuf does not keep track of its usage, so claim the largest chunk
+     * that can still be allocated until not even a snip fits anymore. Only
+     * gaps smaller than a snip are counted as used. */
+    while ((pkt = gnrc_pktbuf_add(NULL, NULL, 0, GNRC_NETTYPE_UNDEF)) != NULL) {
+        size_t min = 0, max = GNRC_PKTBUF_SIZE;
+
+        gnrc_pktbuf_release(pkt);
+        while (min < max) {
+            size_t size = (min + max + 1) / 2;
+
+            pkt = gnrc_pktbuf_add(NULL, NULL, size, GNRC_NETTYPE_UNDEF);
+            if (pkt != NULL) {
+                gnrc_pktbuf_release(pkt);
+                min = size;
+            }
+            else {
+                max = size - 1;
+            }
+        }
+        pkt = gnrc_pktbuf_add(NULL, NULL, min, GNRC_NETTYPE_UNDEF);
+        pkt->next = claimed;
+        claimed = pkt;
+        unused += _pktbuf_align(sizeof(gnrc_pktsnip_t)) + _pktbuf_align(min);
+    }
+    if (claimed != NULL) {
+        gnrc_pktbuf_release(claimed);
+    }
+    return GNRC_PKTBUF_SIZE - unused;
+}
+
+void stack_pktbuf_sample(void)
+{
+    size_t used = stack_pktbuf_used();
+
+    if (used > _pktbuf_peak) {
+        _pktbuf_peak = used;
+    }
+}
+
+size_t stack_pktbuf_peak(void)
+{
+    size_t peak = _pktbuf_peak;
+
+    _pktbuf_peak = 0;
+    return peak;
 }
 
 #ifdef STACK_MULTIHOP
+#ifdef EXP_LPM
+#ifdef STACK_RPL
+#error "routes of RPL are not indexed, so EXP_LPM would shadow them"
+#endif
+
+#define _LPM_NEXT_HOPS_NUMOF    (4)
+
+typedef struct {
+    ipv6_addr_t addr;
+    kernel_pid_t iface;
+} _next_hop_t;
+
+/* the index only stores pointers, so the next hops are kept here */
+static _next_hop_t _next_hops[_LPM_NEXT_HOPS_NUMOF];
+static unsigned _next_hops_numof;
+
+int __real_fib_get_next_hop(fib_table_t *table, kernel_pid_t *iface_id,
+                            uint8_t *next_hop, size_t *next_hop_size,
+                            uint32_t *next_hop_flags, uint8_t *dst,
+                            size_t dst_size, uint32_t dst_flags);
+
+static void _lpm_add(int iface, const ipv6_addr_t *prefix, uint8_t prefix_len,
+                     const ipv6_addr_t *next_hop)
+{
+    _next_hop_t *entry = NULL;
+
+    for (unsigned i = 0; i < _next_hops_numof; i++) {
+        if ((_next_hops[i].iface == _pids[iface]) &&
+            ipv6_addr_equal(&_next_hops[i].addr, next_hop)) {
+            entry = &_next_hops[i];
+            break;
+        }
+    }
+    if (entry == NULL) {
+        if (_next_hops_numof >= _LPM_NEXT_HOPS_NUMOF) {
+            DEBUG("stack: no space for next hop in LPM index\n");
+            return;
+        }
+        entry = &_next_hops[_next_hops_numof++];
+        memcpy(&entry->addr, next_hop, sizeof(ipv6_addr_t));
+        entry->iface = _pids[iface];
+    }
+    if (lpm_add(prefix, prefix_len, entry) < 0) {
+        DEBUG("stack: no space for route in LPM index\n");
+    }
+}
+
+/* linked in place of fib_get_next_hop() with LPM=1 (see time_tx_fib/gnrc) */
+int __wrap_fib_get_next_hop(fib_table_t *table, kernel_pid_t *iface_id,
+                            uint8_t *next_hop, size_t *next_hop_size,
+                            uint32_t *next_hop_flags, uint8_t *dst,
+                            size_t dst_size, uint32_t dst_flags)
+{
+    const _next_hop_t *entry;
+
+    if ((table != &gnrc_ipv6_fib_table) || (dst_size != sizeof(ipv6_addr_t)) ||
+        ((entry = lpm_lookup((ipv6_addr_t *)dst)) == NULL)) {
+        return __real_fib_get_next_hop(table, iface_id, next_hop,
+                                       next_hop_size, next_hop_flags, dst,
+                                       dst_size, dst_flags);
+    }
+    if (*next_hop_size < sizeof(ipv6_addr_t)) {
+        return -ENOBUFS;
+    }
+    memcpy(next_hop, &entry->addr, sizeof(ipv6_addr_t));
+    *next_hop_size = sizeof(ipv6_addr_t);
+    *next_hop_flags = 0;
+    *iface_id = entry->iface;
+    return 0;
+}
+#endif
+
 const ipv6_addr_t *stack_add_prefix(int iface, const ipv6_addr_t *prefix,
                                     uint8_t prefix_len)
 {
@@ -84,15 +540,29 @@ const ipv6_addr_t *stack_add_prefix(int iface, const ipv6_addr_t *prefix,
 void stack_add_route(int iface, const ipv6_addr_t *prefix, uint8_t prefix_len,
                      const ipv6_addr_t *next_hop)
 {
-    uint32_t prefix_flags = 0;
-    (void)prefix_len;
-    if (ipv6_addr_is_unspecified(prefix)) {
-        prefix_flags |= (((uint32_t)prefix_len) << FIB_FLAG_NET_PREFIX_SHIFT);
-    }
+    /* the FIB needs the length of every prefix, not only of the default
+     * route, for the longest prefix match */
+    uint32_t prefix_flags = ((uint32_t)prefix_len) << FIB_FLAG_NET_PREFIX_SHIFT;
+
     fib_add_entry(&gnrc_ipv6_fib_table, _pids[iface],
                   (uint8_t *)prefix, sizeof(ipv6_addr_t), prefix_flags,
                   (uint8_t *)next_hop, sizeof(ipv6_addr_t), 0,
                   (uint32_t)FIB_LIFETIME_NO_EXPIRE);
+#ifdef EXP_LPM
+    _lpm_add(iface, prefix, prefix_len, next_hop);
+#endif
+}
+
+bool stack_has_route(const ipv6_addr_t *dst)
+{
+    ipv6_addr_t next_hop;
+    size_t next_hop_size = sizeof(next_hop);
+    kernel_pid_t iface = KERNEL_PID_UNDEF;
+    uint32_t next_hop_flags = 0;
+
+    return (fib_get_next_hop(&gnrc_ipv6_fib_table, &iface, next_hop.u8,
+                             &next_hop_size, &next_hop_flags, (uint8_t *)dst,
+                             sizeof(ipv6_addr_t), 0) == 0);
 }
 #endif
 
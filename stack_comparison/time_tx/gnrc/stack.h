@@ -17,6 +17,9 @@
 #ifndef STACK_H_
 #define STACK_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "net/ipv6/addr.h"
 
 #ifdef __cplusplus
@@ -25,16 +28,61 @@ extern "C" {
 
 /**
  * @brief   Initialize stack.
+ *
+ * Returns when the stack is ready to send and receive, main() reports the
+ * time it took as `startup`.
  */
 void stack_init(void);
 
 void stack_add_neighbor(int iface, const ipv6_addr_t *ipv6_addr,
                         const uint8_t *l2_addr, uint8_t l2_addr_len);
+
+/**
+ * @brief   Name of what stack_pktbuf_used() and stack_pktbuf_peak() count in
+ *          the output
+ *
+ * - gnrc: bytes allocated in gnrc_pktbuf
+ * - lwIP: bytes allocated in the heap and the pbuf pool
+ * - emb6: length of the datagram in uip_buf, emb6 allocates nothing
+ */
+#if defined(MODULE_EMB6)
+#define STACK_PKTBUF_NAME       "uip_buf"
+#else
+#define STACK_PKTBUF_NAME       "pktbuf"
+#endif
+
+/**
+ * @brief   Get the number of bytes currently allocated in the stack's packet
+ *          buffer
+ */
+size_t stack_pktbuf_used(void);
+
+/**
+ * @brief   Update the peak usage of the stack's packet buffer for
+ *          stack_pktbuf_peak()
+ *
+ * Call this where the buffer is expected to be fullest, stacks that keep
+ * track of their peak usage themselves ignore it.
+ */
+void stack_pktbuf_sample(void);
+
+/**
+ * @brief   Get the peak number of bytes allocated in the stack's packet buffer
+ *          since the last call
+ */
+size_t stack_pktbuf_peak(void);
+
 #ifdef STACK_MULTIHOP
 const ipv6_addr_t *stack_add_prefix(int iface, const ipv6_addr_t *prefix,
                                     uint8_t prefix_len);
 void stack_add_route(int iface, const ipv6_addr_t *prefix, uint8_t prefix_len,
                      const ipv6_addr_t *next_hop);
+
+/**
+ * @brief   Check if the stack has a route to @p dst, e.g. a default route
+ *          installed by RPL
+ */
+bool stack_has_route(const ipv6_addr_t *dst);
 #endif
 #ifdef STACK_RPL
 void stack_init_rpl(int iface, const ipv6_addr_t *dodag_id);
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <string.h>
+
+#include "stats.h"
+
+#define SUB_BUCKETS     (1U << STATS_SUB_BITS)
+
+static inline unsigned _bucket(uint32_t value)
+{
+    unsigned msb;
+
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    msb = 31 - __builtin_clz(value);
+    return ((msb - STATS_SUB_BITS + 1) << STATS_SUB_BITS) |
+           ((value >> (msb - STATS_SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+static inline uint32_t _bucket_max(unsigned bucket)
+{
+    unsigned shift;
+
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    shift = (bucket >> STATS_SUB_BITS) - 1;
+    return (((SUB_BUCKETS | (bucket & (SUB_BUCKETS - 1))) << shift) +
+            ((1UL << shift) - 1));
+}
+
+static uint32_t _isqrt(uint64_t value)
+{
+    uint64_t res = 0, bit = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= (res + bit)) {
+            value -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)res;
+}
+
+void stats_init(stats_t *stats)
+{
+    memset(stats, 0, sizeof(stats_t));
+    stats->min = UINT32_MAX;
+}
+
+void stats_add(stats_t *stats, uint32_t value)
+{
+    double delta = value - stats->mean;
+
+    stats->count++;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+    if (value < stats->min) {
+        stats->min = value;
+    }
+    if (value > stats->max) {
+        stats->max = value;
+    }
+    stats->hist[_bucket(value)]++;
+}
+
+uint32_t stats_stddev(const stats_t *stats)
+{
+    if (stats->count < 2) {
+        return 0;
+    }
+    return _isqrt((uint64_t)(stats->m2 / (stats->count - 1)));
+}
+
+uint32_t stats_percentile(const stats_t *stats, unsigned permille)
+{
+    /* rank of the percentile, rounded up */
+    uint32_t rank = (((uint64_t)stats->count * permille) + 999) / 1000;
+    uint32_t seen = 0;
+
+    if (stats->count == 0) {
+        return 0;
+    }
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (unsigned i = 0; i < STATS_BUCKETS; i++) {
+        seen += stats->hist[i];
+        if (seen >= rank) {
+            uint32_t res = _bucket_max(i);
+
+            if (res > stats->max) {
+                res = stats->max;
+            }
+            if (res < stats->min) {
+                res = stats->min;
+            }
+            return res;
+        }
+    }
+    return stats->max;
+}
+
+/** @} */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Streaming statistics of measured values
+ *
+ * Keeps count, minimum, maximum, mean and variance (Welford's algorithm) and a
+ * log-linear histogram for percentiles without storing the values. Every
+ * power of two is split into 2^@ref STATS_SUB_BITS buckets, so percentiles
+ * have a relative error of at most 2^-@ref STATS_SUB_BITS.
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef STATS_SUB_BITS
+#define STATS_SUB_BITS      (3U)    /**< log2 of buckets per power of two */
+#endif
+
+/**
+ * @brief   Number of histogram buckets to cover 32-bit values
+ */
+#define STATS_BUCKETS       ((32U - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+
+/**
+ * @brief   Statistics accumulator
+ */
+typedef struct {
+    uint32_t count;                 /**< number of values */
+    uint32_t min;                   /**< minimum value */
+    uint32_t max;                   /**< maximum value */
+    double mean;                    /**< running mean */
+    double m2;                      /**< running sum of squared differences */
+    uint32_t hist[STATS_BUCKETS];   /**< log-linear histogram */
+} stats_t;
+
+/**
+ * @brief   Resets @p stats
+ */
+void stats_init(stats_t *stats);
+
+/**
+ * @brief   Adds @p value to @p stats
+ */
+void stats_add(stats_t *stats, uint32_t value);
+
+/**
+ * @brief   Gets the sample standard deviation of @p stats
+ */
+uint32_t stats_stddev(const stats_t *stats);
+
+/**
+ * @brief   Gets a percentile of @p stats
+ *
+ * @param[in] stats     Statistics.
+ * @param[in] permille  Percentile in 1/1000, e.g. 990 for p99.
+ *
+ * @return  Upper bound of the histogram bucket containing the percentile,
+ *          limited by the minimum and maximum value.
+ */
+uint32_t stats_percentile(const stats_t *stats, unsigned permille);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H_ */
+/** @} */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2016 Martine Lenders <mlenders@inf.fu-berlin.de>
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Clock source for time measurements
+ *
+ * The clock source is selected at build time with `TIMING` in
+ * Makefile.common:
+ *
+ * - `xtimer` (`EXP_CLOCK_XTIMER`): xtimer_now() in microseconds
+ * - `dwt` (`EXP_CLOCK_DWT`, default for iotlab-m3): DWT cycle counter of
+ *   Cortex-M3/M4 in CPU cycles
+ * - `monotonic` (`EXP_CLOCK_MONOTONIC`, default for native):
+ *   `CLOCK_MONOTONIC_RAW` of the host in nanoseconds
+ *
+ * @author  Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include <stdint.h>
+
+#if defined(EXP_CLOCK_DWT)
+#include "cpu.h"
+#include "periph_conf.h"
+#elif defined(EXP_CLOCK_MONOTONIC)
+#include <time.h>
+#else
+#include "xtimer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Name and frequency of the clock source
+ */
+#if defined(EXP_CLOCK_DWT)
+#define TIMING_NAME     "dwt"
+#define TIMING_HZ       (CLOCK_CORECLOCK)
+#elif defined(EXP_CLOCK_MONOTONIC)
+#define TIMING_NAME     "monotonic"
+#define TIMING_HZ       (1000000000UL)
+#else
+#define TIMING_NAME     "xtimer"
+#define TIMING_HZ       (1000000UL)
+#endif
+
+/**
+ * @brief   Initializes the clock source
+ */
+static inline void timing_init(void)
+{
+#if defined(EXP_CLOCK_DWT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @brief   Current time in ticks of the clock source
+ *
+ * Wraps around every 2^32 ticks (~4.3 s for `monotonic`, ~60 s for `dwt` at
+ * 72 MHz, ~71 min for `xtimer`), so only the difference of two values less
+ * than that apart is meaningful. Longer intervals need to be summed up from
+ * such differences in a `uint64_t`.
+ */
+static inline uint32_t timing_now(void)
+{
+#if defined(EXP_CLOCK_DWT)
+    return DWT->CYCCNT;
+#elif defined(EXP_CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint32_t)((ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+#else
+    return xtimer_now();
+#endif
+}
+
+/**
+ * @brief   Converts ticks of the clock source to nanoseconds
+ */
+static inline uint64_t timing_ticks_to_ns(uint64_t ticks)
+{
+    /* seconds and the rest separately, so `ticks * 10^9` can't overflow */
+    return ((ticks / TIMING_HZ) * 1000000000ULL) +
+           (((ticks % TIMING_HZ) * 1000000000ULL) / TIMING_HZ);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMING_H_ */
+/** @} */
@@ -0,0 +1 @@
+../gnrc/flow.h
\ No newline at end of file
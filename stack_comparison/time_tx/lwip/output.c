@@ -0,0 +1 @@
+../gnrc/output.c
\ No newline at end of file
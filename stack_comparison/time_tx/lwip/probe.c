@@ -0,0 +1 @@
+../gnrc/probe.c
\ No newline at end of file
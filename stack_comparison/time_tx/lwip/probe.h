@@ -0,0 +1 @@
+../gnrc/probe.h
\ No newline at end of file
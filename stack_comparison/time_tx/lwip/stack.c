@@ -16,18 +16,104 @@
 #include <inttypes.h>
 
 #include "lwip.h"
+#ifdef EXP_PROBES
+#include "lwip/ip6.h"
+#endif
+#include "lwip/memp.h"
 #include "lwip/nd6.h"
+#include "lwip/stats.h"
+#include "lwip/sys.h"
 #include "lwip/tcpip.h"
+#ifdef EXP_PROBES
+#include "lwip/udp.h"
+#endif
 #include "lwip/netif/netdev2.h"
 #include "lwip/netif.h"
 #include "netif/lowpan6.h"
-#include "xtimer.h"
+#include "sema.h"
 
+#ifdef EXP_NC_HASH
+#include "nc_hash.h"
+#endif
 #include "netdev.h"
+#include "probe.h"
 
 #include "stack.h"
 
 static struct netif netifs[NETDEV_NUMOF];
+static sema_t ready = SEMA_CREATE(0);
+
+#ifdef EXP_PROBES
+static netif_output_ip6_fn _lowpan6_output;
+
+err_t __real_udp_sendto(struct udp_pcb *pcb, struct pbuf *p,
+                        const ip_addr_t *dst_ip, u16_t dst_port);
+err_t __real_ip6_output_if_src(struct pbuf *p, const ip6_addr_t *src,
+                               const ip6_addr_t *dest, u8_t hl, u8_t tc,
+                               u8_t nexth, struct netif *netif);
+err_t __real_ip6_input(struct pbuf *p, struct netif *inp);
+void __real_udp_input(struct pbuf *p, struct netif *inp);
+
+/* the probes are linked in front of the layers' entry points with PROBES=1
+ * (see time_tx/Makefile.common) */
+err_t __wrap_udp_sendto(struct udp_pcb *pcb, struct pbuf *p,
+                        const ip_addr_t *dst_ip, u16_t dst_port)
+{
+    probe_record(PROBE_UDP);
+    return __real_udp_sendto(pcb, p, dst_ip, dst_port);
+}
+
+err_t __wrap_ip6_output_if_src(struct pbuf *p, const ip6_addr_t *src,
+                               const ip6_addr_t *dest, u8_t hl, u8_t tc,
+                               u8_t nexth, struct netif *netif)
+{
+    probe_record(PROBE_IPV6);
+    return __real_ip6_output_if_src(p, src, dest, hl, tc, nexth, netif);
+}
+
+err_t __wrap_ip6_input(struct pbuf *p, struct netif *inp)
+{
+    probe_record(PROBE_IPV6);
+    return __real_ip6_input(p, inp);
+}
+
+void __wrap_udp_input(struct pbuf *p, struct netif *inp)
+{
+    probe_record(PROBE_UDP);
+    __real_udp_input(p, inp);
+}
+
+/* lowpan6_output() and lowpan6_input() are only called through function
+ * pointers set within lowpan6.c, so they can't be wrapped by the linker */
+static err_t _probe_lowpan6_output(struct netif *netif, struct pbuf *p,
+                                   const ip6_addr_t *ipaddr)
+{
+    probe_record(PROBE_SIXLOWPAN);
+    return _lowpan6_output(netif, p, ipaddr);
+}
+
+static err_t _probe_lowpan6_input(struct pbuf *p, struct netif *netif)
+{
+    probe_record(PROBE_SIXLOWPAN);
+    return lowpan6_input(p, netif);
+}
+
+/* tcpip_6lowpan_input() with lowpan6_input() probed */
+static err_t _probe_tcpip_input(struct pbuf *p, struct netif *inp)
+{
+    return tcpip_inpkt(p, inp, _probe_lowpan6_input);
+}
+
+#define _TCPIP_INPUT    _probe_tcpip_input
+#else
+#define _TCPIP_INPUT    tcpip_6lowpan_input
+#endif
+
+static void _tcpip_ready(void *arg)
+{
+    (void)arg;
+    sema_post(&ready);
+}
 
 void stack_init(void)
 {
@@ -36,16 +122,49 @@ void stack_init(void)
     assert(netdevs[0].netdev.netdev.driver);
     iid[0] ^= 0x02;
     for (unsigned i = 0; i < NETDEV_NUMOF; i++) {
-        netif_add(&netifs[i], &netdevs[i], lwip_netdev2_init,
-                  tcpip_6lowpan_input);
+        netif_add(&netifs[i], &netdevs[i], lwip_netdev2_init, _TCPIP_INPUT);
+#ifdef EXP_PROBES
+        _lowpan6_output = netifs[i].output_ip6;
+        netifs[i].output_ip6 = _probe_lowpan6_output;
+#endif
         /* set proper IID */
         iid[7] = (i & 0xff);
         ipv6_addr_set_aiid((ipv6_addr_t *)&netifs[i].ip6_addr[0], iid);
+        /* the link is mocked by netdev2_test, so DAD can't find a duplicate:
+         * the address is valid right away instead of after
+         * LWIP_IPV6_DUP_DETECT_ATTEMPTS rounds of nd6_tmr() */
+        netif_ip6_addr_set_state(&netifs[i], 0, IP6_ADDR_PREFERRED);
     }
     netif_set_default(&netifs[0]);
     lwip_bootstrap();
-    xtimer_sleep(3);    /* Let the auto-configuration run warm */
+    /* the tcpip thread handles its messages in order, so it is up once it
+     * called back */
+    tcpip_callback(_tcpip_ready, NULL);
+    sema_wait(&ready);
+}
+
+#ifdef EXP_NC_HASH
+s8_t __real_nd6_get_next_hop_entry(const ip6_addr_t *ip6addr,
+                                   struct netif *netif);
+
+/* linked in place of nd6_get_next_hop_entry() with NC_HASH=1 (see
+ * time_tx_nc/lwip) */
+s8_t __wrap_nd6_get_next_hop_entry(const ip6_addr_t *ip6addr,
+                                   struct netif *netif)
+{
+    struct nd6_neighbor_cache_entry *nc;
+
+    /* only link-local destinations are their own next hop, all others need
+     * the destination cache and the routers of the real lookup */
+    if (ip6_addr_islinklocal(ip6addr) &&
+        ((nc = nc_hash_lookup((const ipv6_addr_t *)ip6addr)) != NULL) &&
+        (nc->state != ND6_NO_ENTRY) && (nc->netif == netif) &&
+        ip6_addr_cmp(&nc->next_hop_address, ip6addr)) {
+        return (s8_t)(nc - neighbor_cache);
+    }
+    return __real_nd6_get_next_hop_entry(ip6addr, netif);
 }
+#endif
 
 void stack_add_neighbor(int iface, const ipv6_addr_t *ipv6_addr,
                         const uint8_t *l2_addr, uint8_t l2_addr_len)
@@ -58,9 +177,51 @@ void stack_add_neighbor(int iface, const ipv6_addr_t *ipv6_addr,
             memcpy(&nc->lladdr, l2_addr, l2_addr_len);
             nc->netif = &netifs[iface];
             nc->counter.reachable_time = UINT32_MAX;
+#ifdef EXP_NC_HASH
+            nc_hash_add(ipv6_addr, nc);
+#endif
             return;
         }
     }
 }
 
+size_t stack_pktbuf_used(void)
+{
+    size_t used = 0;
+
+#if MEM_STATS
+    used += lwip_stats.mem.used;
+#endif
+#if MEMP_STATS
+    used += lwip_stats.memp[MEMP_PBUF_POOL]->used *
+            memp_pools[MEMP_PBUF_POOL]->size;
+#endif
+    return used;
+}
+
+void stack_pktbuf_sample(void)
+{
+    /* lwIP keeps track of the peaks itself */
+}
+
+size_t stack_pktbuf_peak(void)
+{
+#if MEM_STATS && MEMP_STATS
+    /* heap (PBUF_RAM) and pbuf pool (PBUF_POOL) might peak at different times,
+     * so this is an upper bound */
+    struct stats_mem *pool = lwip_stats.memp[MEMP_PBUF_POOL];
+    size_t peak;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    SYS_ARCH_PROTECT(lev);
+    peak = lwip_stats.mem.max + (pool->max * memp_pools[MEMP_PBUF_POOL]->size);
+    lwip_stats.mem.max = lwip_stats.mem.used;
+    pool->max = pool->used;
+    SYS_ARCH_UNPROTECT(lev);
+    return peak;
+#else
+    return 0;
+#endif
+}
+
 /** @} */
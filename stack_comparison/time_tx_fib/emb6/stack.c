@@ -0,0 +1 @@
+../../time_tx/emb6/stack.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../time_tx/gnrc/stack.h
\ No newline at end of file
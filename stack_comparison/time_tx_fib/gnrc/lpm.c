@@ -0,0 +1 @@
+../../time_tx/gnrc/lpm.c
\ No newline at end of file
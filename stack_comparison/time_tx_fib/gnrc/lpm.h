@@ -0,0 +1 @@
+../../time_tx/gnrc/lpm.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../time_tx/gnrc/netdev.h
\ No newline at end of file
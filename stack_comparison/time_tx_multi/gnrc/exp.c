@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2016 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief   Drives all @ref NETDEV_NUMOF interfaces concurrently
+ *
+ * Every interface has a sender thread that keeps exactly one datagram in
+ * flight on its interface: it sends the next datagram as soon as the mock
+ * device completed the last one. Per payload size one row per interface and
+ * one row for all interfaces (`iface` = `all`) is printed with the traversal
+ * times and the throughput.
+ *
+ * @author Martine Lenders <mlenders@inf.fu-berlin.de>
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "irq.h"
+#include "net/af.h"
+#include "net/conn/udp.h"
+#include "net/ipv6/addr.h"
+#include "net/netdev2_test.h"
+#include "sema.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#include "netdev.h"
+#include "stack.h"
+#include "stats.h"
+#include "timing.h"
+
+#include "exp.h"
+
+#define THREAD_PRIO         (EXP_MULTI_PRIO)
+#define THREAD_STACK_SIZE   (EXP_STACKSIZE_EXP)
+#define ALL                 (NETDEV_NUMOF)
+
+static const uint8_t honeyguide[] = { 0x2d, 0x4e };
+
+#define HONEYGUIDE_LEN  (sizeof(honeyguide))
+#define TAIL_LEN        (HONEYGUIDE_LEN + sizeof(uint16_t))
+
+typedef struct {
+    ipv6_addr_t src;
+    ipv6_addr_t dst;
+    sema_t start;
+    sema_t sent;
+    uint32_t timer;
+    volatile int16_t id;    /**< ID of the datagram in flight, -1 if none */
+    uint32_t completed;
+    uint32_t lost;
+    uint8_t payload[EXP_MAX_PAYLOAD];
+} _iface_t;
+
+static _iface_t ifaces[NETDEV_NUMOF];
+static stats_t stats[NETDEV_NUMOF + 1];
+static char thread_stacks[NETDEV_NUMOF][THREAD_STACK_SIZE];
+static sema_t done = SEMA_CREATE(0);
+static uint16_t payload_size;
+/* summed up per completion, since a run can take longer than timing_now()
+ * takes to wrap around */
+static volatile uint64_t duration;
+static volatile uint32_t last_completion;
+
+static int _netdev2_send(netdev2_t *dev, const struct iovec *vector, int count)
+{
+    /* first things first */
+    const uint32_t stop = timing_now();
+    const uint8_t *payload = vector[count - 1].iov_base;
+    const size_t payload_len = vector[count - 1].iov_len;
+    const uint8_t *_hg = &payload[payload_len - HONEYGUIDE_LEN];
+    const unsigned iface = (netdev2_test_t *)dev - netdevs;
+    unsigned state;
+    int res = 0;
+
+    for (int i = 0; i < count; i++) {
+        res += vector[i].iov_len;
+    }
+
+    /* filter out unwanted packets */
+    if ((payload_len < TAIL_LEN) ||
+        (memcmp(_hg, honeyguide, HONEYGUIDE_LEN) != 0)) {
+        return res;
+    }
+    state = disableIRQ();
+    if (payload[payload_len - TAIL_LEN - 1] != ifaces[iface].id) {
+        /* the sender already gave up on this datagram */
+        restoreIRQ(state);
+        return res;
+    }
+    ifaces[iface].id = -1;
+    stats_add(&stats[iface], stop - ifaces[iface].timer);
+    stats_add(&stats[ALL], stop - ifaces[iface].timer);
+    ifaces[iface].completed++;
+    duration += stop - last_completion;
+    last_completion = stop;
+    restoreIRQ(state);
+    sema_post(&ifaces[iface].sent);
+    return res;
+}
+
+static void *_sender(void *arg)
+{
+    _iface_t *iface = arg;
+
+    while (1) {
+        sema_wait(&iface->start);
+        memcpy(&iface->payload[payload_size - TAIL_LEN], &payload_size,
+               sizeof(uint16_t));
+        memcpy(&iface->payload[payload_size - HONEYGUIDE_LEN], honeyguide,
+               sizeof(honeyguide));
+        for (unsigned id = 0; id < EXP_RUNS; id++) {
+            iface->payload[payload_size - TAIL_LEN - 1] = id & 0xff;
+            iface->timer = timing_now();
+            iface->id = id & 0xff;
+            conn_udp_sendto(iface->payload, payload_size, &iface->src,
+                            sizeof(iface->src), &iface->dst,
+                            sizeof(iface->dst), AF_INET6, EXP_SRC_PORT,
+                            EXP_DST_PORT);
+            if (sema_wait_timed(&iface->sent, EXP_MULTI_TIMEOUT) < 0) {
+                unsigned state = disableIRQ();
+
+                /* the datagram might have been completed in the meantime */
+                if (iface->id >= 0) {
+                    iface->id = -1;
+                    iface->lost++;
+                }
+                /* a late completion must not complete the next datagram */
+                sema_create(&iface->sent, 0);
+                restoreIRQ(state);
+            }
+        }
+        sema_post(&done);
+    }
+    return NULL;
+}
+
+static void _print_row(const char *iface, const stats_t *s, uint32_t lost,
+                       uint64_t duration)
+{
+    uint64_t pps = 0, bps = 0;
+
+    if (duration > 0) {
+        pps = ((uint64_t)s->count * TIMING_HZ) / duration;
+        bps = ((uint64_t)s->count * payload_size * TIMING_HZ) / duration;
+    }
+    printf("%u,%u,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%" PRIu64
+           ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu32 ",%" PRIu32
+           ",%" PRIu32 "\n", (unsigned)payload_size, (unsigned)NETDEV_NUMOF,
+           iface, s->count, lost,
+           timing_ticks_to_ns((s->count > 0) ? s->min : 0),
+           timing_ticks_to_ns((uint64_t)s->mean),
+           timing_ticks_to_ns(stats_percentile(s, 500)),
+           timing_ticks_to_ns(stats_percentile(s, 990)),
+           timing_ticks_to_ns(s->max),
+           (uint32_t)((duration * 1000000U) / TIMING_HZ),
+           (uint32_t)pps, (uint32_t)bps);
+}
+
+void exp_run(void)
+{
+    for (unsigned i = 0; i < NETDEV_NUMOF; i++) {
+        netdev2_t *netdev = (netdev2_t *)&netdevs[i];
+        _iface_t *iface = &ifaces[i];
+        const ipv6_addr_t dst = EXP_ADDR;
+        uint8_t dst_l2[] = EXP_ADDR_L2;
+
+        /* every interface has its own neighbor, so the stack has to select
+         * the interface by the destination */
+        dst_l2[7] ^= i;
+        memcpy(&iface->dst, &dst, sizeof(dst));
+        iface->dst.u8[15] ^= i;
+        ipv6_addr_set_link_local_prefix(&iface->src);
+        netdev->driver->get(netdev, NETOPT_IPV6_IID, &iface->src.u64[1],
+                            sizeof(iface->src.u64[1]));
+        sema_create(&iface->start, 0);
+        sema_create(&iface->sent, 0);
+        iface->id = -1;
+        memset(iface->payload, 0, sizeof(iface->payload));
+        netdev2_test_set_send_cb(&netdevs[i], _netdev2_send);
+        stack_add_neighbor(i, &iface->dst, dst_l2, sizeof(dst_l2));
+        if (thread_create(thread_stacks[i], sizeof(thread_stacks[i]),
+                          THREAD_PRIO, THREAD_CREATE_STACKTEST, _sender,
+                          iface, "exp_sender") < 0) {
+            return;
+        }
+    }
+    puts("payload_len,ifaces,iface,completed,lost,min_ns,mean_ns,p50_ns,"
+         "p99_ns,max_ns,duration_us,packets_per_s,bytes_per_s");
+    for (payload_size = EXP_MIN_PAYLOAD; payload_size <= EXP_MAX_PAYLOAD;
+         payload_size += EXP_PAYLOAD_STEP) {
+        uint32_t lost = 0;
+        char name[4];
+
+        for (unsigned i = 0; i <= ALL; i++) {
+            stats_init(&stats[i]);
+        }
+        duration = 0;
+        last_completion = timing_now();
+        for (unsigned i = 0; i < NETDEV_NUMOF; i++) {
+            ifaces[i].completed = 0;
+            ifaces[i].lost = 0;
+            sema_post(&ifaces[i].start);
+        }
+        for (unsigned i = 0; i < NETDEV_NUMOF; i++) {
+            sema_wait(&done);
+        }
+        for (unsigned i = 0; i < NETDEV_NUMOF; i++) {
+            snprintf(name, sizeof(name), "%u", i);
+            _print_row(name, &stats[i], ifaces[i].lost, duration);
+            lost += ifaces[i].lost;
+        }
+        _print_row("all", &stats[ALL], lost, duration);
+    }
+}
+
+/** @} */
@@ -0,0 +1 @@
+../../time_tx/gnrc/exp.h
\ No newline at end of file
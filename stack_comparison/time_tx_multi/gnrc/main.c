@@ -0,0 +1 @@
+../../time_tx/gnrc/main.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../time_tx/gnrc/stats.c
\ No newline at end of file
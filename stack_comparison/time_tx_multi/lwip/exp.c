@@ -0,0 +1 @@
+../gnrc/exp.c
\ No newline at end of file
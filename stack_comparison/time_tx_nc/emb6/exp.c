@@ -0,0 +1 @@
+../../time_tx/gnrc/exp.c
\ No newline at end of file
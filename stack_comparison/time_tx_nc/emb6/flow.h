@@ -0,0 +1 @@
+../../time_tx/gnrc/flow.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../time_tx/gnrc/output.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../time_tx/gnrc/nc_hash.c
\ No newline at end of file
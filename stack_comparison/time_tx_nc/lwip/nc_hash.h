@@ -0,0 +1 @@
+../../time_tx/gnrc/nc_hash.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../time_tx/lwip/stack.c
\ No newline at end of file